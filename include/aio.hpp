@@ -0,0 +1,138 @@
+#pragma once
+/**
+ * FILE: aio.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Asynchronous I/O of the large sequential files: the Reads files, the index parts, the references
+ * and the FASTA/Q, SAM and BLAST output ('--io_engine').
+ *
+ * A file is read (written) in AIO_CHUNK chunks with AIO_DEPTH chunks in flight, so that the disk
+ * works ahead of the thread consuming the data, and behind the thread producing it:
+ *   stream - std::filebuf i.e. blocking reads/writes of the stream buffer size. Default
+ *   pread  - pread/pwrite of the chunks on helper threads
+ *   uring  - Linux io_uring, a ring per file. Falls back to 'pread' with a warning when the kernel
+ *            (or the build i.e. no <linux/io_uring.h>) has no io_uring
+ * The engine is set once with 'Aio::set_mode' before any file is opened.
+ *
+ * AioIfstream/AioOfstream stand in for std::ifstream/std::ofstream, only the stream buffer differs.
+ * The output is written when a chunk is full and on 'close': 'flush' (std::endl) does not force a
+ * write with the asynchronous engines.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+#define AIO_CHUNK (1U << 20) /* bytes per read/write request */
+#define AIO_DEPTH 4U /* requests in flight per file */
+
+class AioQueue; // aio.cpp
+
+class Aio {
+public:
+	static void set_mode(const std::string &mode); // stream | pread | uring
+	static bool is_stream();
+};
+
+// read ahead stream buffer
+class AioInBuf : public std::streambuf {
+public:
+	AioInBuf();
+	~AioInBuf();
+	AioInBuf(const AioInBuf &) = delete;
+	AioInBuf & operator=(const AioInBuf &) = delete;
+
+	bool open(const std::string &path);
+	bool is_open() const { return fd >= 0; }
+	void close();
+
+protected:
+	int_type underflow() override;
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+	struct Slot {
+		std::vector<char> data;
+		uint64_t off = 0; // file offset of the chunk
+		std::size_t len = 0; // requested bytes
+		bool is_pending = false;
+	};
+	void submit(unsigned idx); // read the chunk at 'next_off' into the slot. Nothing at the end of the file
+	void drain(); // wait for all the reads in flight
+	uint64_t tell() const; // file offset of the get pointer
+
+	int fd = -1;
+	uint64_t file_size = 0;
+	uint64_t next_off = 0; // offset of the next chunk to read
+	std::vector<Slot> slots;
+	unsigned cur = 0; // the slot consumed next, or holding the get area
+	bool is_cur = false; // 'cur' holds the get area
+	std::unique_ptr<AioQueue> queue;
+}; // ~class AioInBuf
+
+// write behind stream buffer
+class AioOutBuf : public std::streambuf {
+public:
+	AioOutBuf();
+	~AioOutBuf();
+	AioOutBuf(const AioOutBuf &) = delete;
+	AioOutBuf & operator=(const AioOutBuf &) = delete;
+
+	bool open(const std::string &path, bool is_append);
+	bool is_open() const { return fd >= 0; }
+	bool close(); // false - a write failed
+
+protected:
+	int_type overflow(int_type ch) override;
+	int sync() override; // no-op: the chunks are written when full and on close
+
+private:
+	struct Slot {
+		std::vector<char> data;
+		std::size_t len = 0;
+		bool is_pending = false;
+	};
+	bool submit(); // write the put area and switch to the next slot
+	bool wait(unsigned idx);
+
+	int fd = -1;
+	uint64_t next_off = 0; // offset of the next chunk to write
+	std::vector<Slot> slots;
+	unsigned cur = 0; // the slot holding the put area
+	bool is_error = false;
+	std::unique_ptr<AioQueue> queue;
+}; // ~class AioOutBuf
+
+class AioIfstream : public std::istream {
+public:
+	AioIfstream() : std::istream(nullptr) {}
+	explicit AioIfstream(const std::string &path, std::ios_base::openmode mode = std::ios_base::in) : AioIfstream() { open(path, mode); }
+
+	void open(const std::string &path, std::ios_base::openmode mode = std::ios_base::in);
+	bool is_open() const;
+	void close();
+
+private:
+	std::unique_ptr<std::streambuf> buf; // std::filebuf ('stream') or AioInBuf
+	bool is_aio = false;
+};
+
+class AioOfstream : public std::ostream {
+public:
+	AioOfstream() : std::ostream(nullptr) {}
+	AioOfstream(AioOfstream &&that) : std::ostream(std::move(that)), buf(std::move(that.buf)), is_aio(that.is_aio) { set_rdbuf(buf.get()); }
+
+	void open(const std::string &path, std::ios_base::openmode mode = std::ios_base::out);
+	bool is_open() const;
+	void close();
+
+private:
+	std::unique_ptr<std::streambuf> buf; // std::filebuf ('stream') or AioOutBuf
+	bool is_aio = false;
+};
@@ -33,6 +33,7 @@
 #include <map>
 #include <queue>
 #include <algorithm>
+#include <chrono>
 
 #include "traverse_bursttrie.hpp"
 #include "ssw.hpp"
@@ -53,6 +54,10 @@ using namespace std;
            per read */
 #define BEST_HITS_INCREMENT 100
 
+/*! @brief Maximum read mismatches on the LIS diagonal
+           aligned without Smith-Waterman. See near_exact_align */
+#define NEAR_EXACT_MAX_MISMATCHES 1
+
 /*! @brief Euler's constant */
 #define EXP 2.71828182845904523536
 
@@ -91,10 +96,12 @@ typedef pair<uint32_t,uint32_t> uint32pair;
 /*! @fn find_lis()
  *  @brief Given a list of matching positions on the read, find the longest
            strictly increasing subsequence, O(n log k)
-    @param deque<pair<uint32_t, uint32_t> > &a  list of matching positions on the read which fall within a range of the read's length on the genome
+    @param const uint32pair *a  list of matching positions on the read which fall within a range of the read's length on the genome
+    @param size_t n  size of the list
     @param vector<uint32_t> &b  array of starting positions of each longest subsequence
+    @param vector<uint32_t> &p  working array of the predecessors (reused between the calls)
 */
-void find_lis(deque<pair<uint32_t, uint32_t> > &a, vector<uint32_t> &b);
+void find_lis(const uint32pair *a, std::size_t n, vector<uint32_t> &b, vector<uint32_t> &p);
 
 /*! @brief struct alignment_struct
    holds the index of the minimum and maximum scoring
@@ -115,8 +122,78 @@ struct alignment_struct
                    s_align* p) : max_size(max_size), size(size), min_index(min), max_index(max), ptr(p) {}
 };
 
+/*! @brief FIFO over a vector: 'pop_front' advances the head, 'clear' keeps the capacity.
+    Replaces the std::deque of the LIS match chain which allocates and frees its blocks as it moves */
+template <typename T>
+struct ScratchQueue
+{
+	std::vector<T> buf;
+	std::size_t head = 0;
+
+	void clear() { buf.clear(); head = 0; }
+	void push_back(const T & val) { buf.push_back(val); }
+	void pop_front() { ++head; }
+	bool empty() const { return head == buf.size(); }
+	std::size_t size() const { return buf.size() - head; }
+	T & front() { return buf[head]; }
+	T & operator[](std::size_t idx) { return buf[head + idx]; }
+	const T * data() const { return buf.data() + head; }
+};
+
+/*! @brief struct ReadBudget
+   Work done on a read in an index part (both strands, all passes) against the limits
+   OPT_MAX_CANDIDATES, OPT_MAX_SW_CELLS, OPT_MAX_READ_TIME. Once over, 'compute_lis_alignment'
+   stops examining candidates and the read keeps the alignments found so far */
+struct ReadBudget
+{
+	uint32_t candidates = 0; // candidate references examined
+	uint64_t sw_cells = 0; // Smith-Waterman cells: query length x reference length
+	std::chrono::steady_clock::time_point start;
+	bool is_over = false;
+
+	void start_read() { candidates = 0; sw_cells = 0; is_over = false; start = std::chrono::steady_clock::now(); }
+	bool check(const Runopts & opts); // sets 'is_over' when a limit is reached. Returns 'is_over'
+};
+
+/*! @brief struct AlignScratch
+   Working storage of 'alignmentCb' and 'compute_lis_alignment' owned by a Processor thread.
+   The containers are cleared, never freed, between the reads, so the steady state alignment
+   does not allocate and the buffers stay hot in the thread's L1/L2 */
+struct AlignScratch
+{
+	vector<bool> read_pos_searched; // alignmentCb: read positions already searched in a previous pass
+	vector<UCHAR> bitvec; // alignmentCb: window (prefix/suffix) bitvector
+	vector<id_win> id_hits; // alignmentCb: ids of the k-mers of a window that hit the database
+	vector<id_win> win_hits; // Processor: lent to the read being aligned as its 'id_win_hits'
+	vector<uint32_t> kmer_count; // compute_lis_alignment: number of the k-mer occurrences per reference. Indexed by reference, kept zeroed
+	vector<uint32_t> kmer_refs; // compute_lis_alignment: references with non-zero 'kmer_count'
+	vector<uint32pair> kmer_count_vec; // compute_lis_alignment: candidate references (reference, k-mer occurrences)
+	vector<uint32pair> hits_per_ref; // compute_lis_alignment: (reference position, read position) of the hits on a candidate
+	ScratchQueue<uint32pair> match_chain; // compute_lis_alignment: hits fit along the read length window
+	vector<uint32_t> lis_arr; // find_lis: indices of the match chain comprising the LIS
+	vector<uint32_t> lis_p; // find_lis: predecessors
+	ReadBudget budget; // work done on the current read. Started by the Processor
+	vector<bool> dust_masked; // alignmentCb: low complexity windows of the read (OPT_DUST)
+	vector<float> win_ee; // alignmentCb: expected errors per window of the read (OPT_MAX_EE)
+
+	std::size_t mem_size() const; // bytes held. See MemStats
+};
+
+/*
+ * ungapped alignment of a near exact read (at most NEAR_EXACT_MAX_MISMATCHES mismatches) on its diagonal:
+ * the best scoring segment (the ends clipped as Smith-Waterman does) with a single 'M' CIGAR.
+ * Declines (returns 0) unless the Smith-Waterman score is the same i.e. no column scores below zero or a gap
+ * costs at least a mismatch turned into a match ('gap_open >= match - mismatch'). calloc'd as by 'ssw_align'
+ *
+ * @param query, ref   04 encoded, 'len' nt each
+ * @param matrix       5 x 5 scoring matrix
+ * @param ref_offset   added to the reference positions of the result
+ */
+s_align* near_exact_align(const char * query, const char * ref, uint32_t len, const int8_t * matrix, long gap_open, int64_t ref_offset);
+
 void compute_lis_alignment(
 	Read & read, Runopts & opts, Index & index, References & refs, Readstats & readstats, Refstats & refstats,
+	AlignScratch & scratch,
 	bool & search,
 	uint32_t max_SW_score,
 	bool& read_to_count
@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * FILE: arena.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Bump allocator over large contiguous chunks for the data living as long as an index part:
+ * the mini-burst tries, the positions arrays and the reference pools.
+ *
+ * The seed search does random accesses across gigabytes of these structures and is dTLB-miss
+ * bound with 4 KB pages. Thousands of small 'new[]' blocks cannot be backed by huge pages, the
+ * arena chunks can:
+ *   thp     - anonymous mappings advised with MADV_HUGEPAGE before they are touched
+ *   hugetlb - MAP_HUGETLB mappings from the hugetlbfs pool (vm.nr_hugepages). Falls back to 'thp'
+ *             with a warning when the pool is exhausted.
+ *   off     - regular pages
+ * The mode is set once from OPT_HUGE_PAGES (see 'Arena::set_mode'). The memory is zero filled.
+ * Not thread safe: the arenas are filled by the main thread while loading an index part.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+class Arena {
+public:
+	Arena() {}
+	~Arena() { clear(); }
+	Arena(const Arena &) = delete;
+	Arena & operator=(const Arena &) = delete;
+
+	static void set_mode(const std::string &mode); // off | thp | hugetlb
+	static void advise(void *ptr, std::size_t len); // advise huge pages for an untouched buffer not allocated from an arena e.g. a reserved vector
+
+	void *alloc(std::size_t bytes, std::size_t align = alignof(std::max_align_t));
+	template <typename T> T *alloc_array(std::size_t num) { return static_cast<T*>(alloc(num * sizeof(T), alignof(T))); }
+	void clear(); // release all the chunks
+	std::size_t size() const { return used_bytes; } // bytes handed out
+	std::size_t reserved() const; // bytes mapped in the chunks
+	std::size_t huge_bytes() const; // bytes of the chunks backed by huge pages
+
+	// single line of the huge page coverage of the used bytes e.g. 'Huge pages [thp]: index 1024.00 MB 98.40% references 64.00 MB 93.75%'
+	static std::string report(const std::vector<std::pair<std::string, const Arena*>> &arenas);
+
+private:
+	struct Chunk {
+		char *ptr;
+		std::size_t size; // mapped size
+		std::size_t used;
+		bool is_mmap; // false - calloc
+		bool is_hugetlb;
+	};
+	void add_chunk(std::size_t min_bytes);
+
+	std::vector<Chunk> chunks;
+	std::size_t used_bytes = 0;
+}; // ~class Arena
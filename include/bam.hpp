@@ -0,0 +1,64 @@
+#pragma once
+/**
+ * FILE: bam.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Record reader of (unaligned) BAM Reads files.
+ *
+ * BAM is a series of BGZF blocks i.e. gzip members of at most 64 KB of data, each carrying its
+ * compressed size in the 'BC' extra field. The blocks are independent: a batch of BAM_BATCH_BLOCKS
+ * blocks is inflated at a time, the blocks of a batch in parallel (BAM_THREADS), and the records
+ * are parsed from the concatenated output.
+ *
+ * Only the primary records are returned (no secondary 0x100, supplementary 0x800). The sequence
+ * and quality of a record mapped to the reverse strand (0x10) are reverted to the read as sequenced.
+ * The mates of a paired uBAM (0x1) are expected consecutive, as written by the sequencers and by
+ * 'samtools collate', first mate (0x40) first.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+
+#define BAM_BATCH_BLOCKS 64U /* BGZF blocks inflated per batch */
+#define BAM_THREADS 4U /* max threads inflating the blocks of a batch */
+
+// BAM flags used
+#define BAM_FPAIRED 0x1
+#define BAM_FREVERSE 0x10
+#define BAM_FREAD1 0x40
+#define BAM_FREAD2 0x80
+#define BAM_FSECONDARY 0x100
+#define BAM_FSUPPLEMENTARY 0x800
+
+struct BamRecord {
+	std::string name;
+	std::string sequence;
+	std::string quality; // Phred+33. Empty if not stored
+	uint16_t flag = 0;
+};
+
+class Bam {
+public:
+	Bam() {}
+
+	int next(std::istream &ifs, BamRecord &rec); // next primary record. RL_OK | RL_END | RL_ERR
+
+	// is a BAM file i.e. BGZF with the BAM magic. 'is_paired' - the first record is paired. Rewinds the stream
+	static bool detect(std::istream &ifs, bool &is_paired);
+
+private:
+	int fill(std::istream &ifs, std::size_t num); // ensure 'num' decompressed bytes from 'pos'. RL_OK | RL_END | RL_ERR
+	int inflate_batch(std::istream &ifs); // inflate the next batch of blocks into 'text'
+	bool read_in(std::istream &ifs); // append the next chunk of the file to 'in'. False at EOF
+	int skip_header(std::istream &ifs);
+
+	std::vector<char> in; // compressed input not yet inflated
+	std::size_t in_pos = 0; // start of the not yet inflated input in 'in'
+	bool is_eof = false; // all the input was read
+	std::string text; // decompressed data not yet parsed
+	std::size_t pos = 0; // start of the not yet parsed data in 'text'
+	bool is_header = false; // the header was skipped
+}; // ~class Bam
@@ -67,6 +67,10 @@ extern int thisread;
 void init_win_f ( char*, UCHAR*, UCHAR*, int numbvs );
 void init_win_r ( char*, UCHAR*, UCHAR*, int numbvs );
 
+/* same with the number of bitvectors known at compile time. Instantiated in bitvector.cpp for the common seed lengths */
+template <int NUMBVS> void init_win_f_n ( char*, UCHAR*, UCHAR*, int numbvs );
+template <int NUMBVS> void init_win_r_n ( char*, UCHAR*, UCHAR*, int numbvs );
+
 
 /*
  *
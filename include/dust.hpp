@@ -0,0 +1,34 @@
+#pragma once
+/**
+ * FILE: dust.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Low complexity masking of the seed windows ('--dust SCORE').
+ *
+ * Homopolymer and short tandem repeat windows match huge numbers of trie entries and positions,
+ * which seldom lead to an alignment but inflate 'id_win_hits' and the LIS work. A window is
+ * masked when its DUST score is above the threshold:
+ *
+ *   score = sum_t c_t * (c_t - 1) / 2 / (l - 1)
+ *
+ * where c_t is the count of the triplet t in the window and l = window length - 2 is the number
+ * of triplets. For an 18 nt window a homopolymer scores 8, a dinucleotide repeat ~3.7 and
+ * a random sequence ~0.1. The scores are computed incrementally along the sequence.
+ *
+ * Applied to the read windows in 'alignmentCb' and to the reference L-mers in 'build_index'.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * mark the windows of length 'win_len' scoring above 'threshold'
+ *
+ * @param seq       sequence in 0..3 alphabet. 4 (ambiguous) is taken as 0 like in the seed search
+ * @param len       sequence length
+ * @param masked    OUT masked[i] - the window starting at 'i' is low complexity. Size: len - win_len + 1
+ * @return number of masked windows
+ */
+std::size_t dust_mask(const char *seq, std::size_t len, uint32_t win_len, double threshold, std::vector<bool> &masked);
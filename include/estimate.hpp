@@ -0,0 +1,31 @@
+#pragma once
+/**
+ * FILE: estimate.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Sampling based estimate of the fraction of reads matching each database ('--estimate WIDTH').
+ *
+ * For QC only the fractions are needed, not the per read classification. A uniform random sample
+ * (reservoir) of the reads is taken by the reads statistics pass ('Readstats::calculate', run also when
+ * the statistics are in the KVDB) i.e. the reads are parsed once. The sample is searched through all the
+ * index parts in batches of doubling size until the 95% (Wilson) confidence intervals of the total and
+ * of every 'reads_matched_per_db' fraction are narrower than WIDTH. The sample never exceeds
+ * (1.96 / WIDTH)^2 reads i.e. the size giving WIDTH for a fraction of 0.5, the worst case.
+ *
+ * Only the log is written. The counts in it are extrapolated to all the reads and followed by the
+ * confidence intervals. Nothing is stored in the KVDB.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <cstddef>
+
+#define ESTIMATE_SEED 1 /* sampling seed, fixed for reproducible estimates */
+
+// forward
+struct Runopts;
+struct Readstats;
+class Output;
+struct Index;
+
+void estimate(Runopts & opts, Readstats & readstats, Output & output, Index & index);
+std::size_t estimate_sample_size(double width); // reads in the sample for the confidence interval width
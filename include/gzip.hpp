@@ -2,16 +2,32 @@
 /* 
  * FILE: gzip.hpp
  * Created: Feb 22, 2018 Thu
+ *
+ * Line reader of the plain, gzip and zstd compressed Reads files.
+ *
+ * zstd (only when built with HAVE_ZSTD):
+ *   A single large frame (e.g. 'zstd reads.fq') is decoded by a streaming context.
+ *   Files of many small independent frames ('pzstd', 'zstd --long -B', the seekable format) are
+ *   decoded a batch of frames at a time, the frames of a batch in parallel (ZSTD_THREADS).
+ *   The mode is chosen by whether the first frame fits into the first input chunk.
  */
 
 #include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
 
 #include "zlib.h"
+#ifdef HAVE_ZSTD
+#include "zstd.h"
+#endif
 
 #include "options.hpp"
 
 #define OUT_SIZE 32768U /* out buffer size */
 #define IN_SIZE 16384      /* file input buffer size */
+#define ZSTD_IN_SIZE (4U << 20) /* zstd: file input chunk size */
+#define ZSTD_THREADS 4U /* zstd: max threads decoding the frames of a batch */
 #define RL_OK 0
 #define RL_END 1
 #define RL_ERR -1
@@ -19,12 +35,16 @@
 class Gzip
 {
 public:
-	Gzip(bool gzipped);
+	Gzip(Runopts::ZIP_FORMAT zip);
 	//~Gzip();
 
-	int getline(std::ifstream & ifs, std::string & line);
+	int getline(std::istream & ifs, std::string & line);
+
+	static Runopts::ZIP_FORMAT detect(std::istream & ifs); // by the magic number. Rewinds the stream
+	static bool is_zstd_supported();
 
 private:
+	Runopts::ZIP_FORMAT zip;
 	bool gzipped;
 	// zlib related
 	char* line_start; // pointer to the start of a line within the 'z_out' buffer
@@ -32,7 +52,25 @@ private:
 	std::vector<unsigned char> z_in; // IN buffer for compressed data
 	std::vector<unsigned char> z_out; // OUT buffer for decompressed data
 
+#ifdef HAVE_ZSTD
+	// zstd related
+	std::shared_ptr<ZSTD_DStream> zds; // streaming context (single frame mode)
+	std::vector<char> zs_in; // compressed input not yet decoded
+	std::size_t zs_in_pos = 0; // start of the not yet decoded input in 'zs_in'
+	std::string zs_text; // decompressed data not yet returned as lines
+	std::size_t zs_pos = 0; // start of the next line in 'zs_text'
+	bool zs_is_init = false;
+	bool zs_is_frames = false; // the frames are decoded in parallel batches
+	bool zs_is_eof = false; // all the input was read
+	bool zs_is_frame_end = true; // streaming: the current frame was fully decoded
+#endif
+
 private:
 	void init();
-	int inflatez(std::ifstream & ifs); // 'z' in the name to distinguish from zlib.inflate
-};
\ No newline at end of file
+	int inflatez(std::istream & ifs); // 'z' in the name to distinguish from zlib.inflate
+#ifdef HAVE_ZSTD
+	int zstd_getline(std::istream & ifs, std::string & line);
+	int zstd_fill(std::istream & ifs); // decode the next portion of the input into 'zs_text'
+	bool zstd_read(std::istream & ifs); // append the next chunk of the file to 'zs_in'. False at EOF
+#endif
+};
@@ -7,11 +7,16 @@
 #include <vector>
 #include <cstdint>
 
+#include "arena.hpp"
+#include "seedhash.hpp"
+#include "refclusters.hpp"
+
 // forward
 struct Runopts;
 struct kmer;
 struct kmer_origin;
 class Refstats;
+struct SeedKernels;
 
 /**
  * 1. Each reference file can be indexed into multiple index parts depending on the file size.
@@ -24,6 +29,15 @@ struct Index {
 
 	std::vector<kmer> lookup_tbl; /**< reference to L/2-mer look up table */
 	std::vector<kmer_origin> positions_tbl; /**< reference to (L+1)-mer positions table */
+	Arena arena; // storage of the mini-burst tries and the seq_pos arrays. Huge page backed (OPT_HUGE_PAGES)
+	const SeedKernels *kernels = nullptr; // seed search functions specialized for the seed length of the loaded part. Set in 'load'
+	SeedHash seed_hash; // exact seeds of a small index part (SEEDHASH_MAX_KMERS). Built in 'load'
+	RefClusters clusters; // members of the indexed centroids (OPT_CLUSTER_ID). Loaded if the index part was clustered
+
+	// memory accounting (see MemStats). Counted in 'load', reset in 'clear'
+	std::size_t arena_bytes = 0; // mini-burst trie arenas (trie nodes + buckets)
+	std::size_t bucket_bytes = 0; // buckets in the arenas
+	std::size_t positions_bytes = 0; // seq_pos arrays of the positions_tbl
 
 	// Index stats
 	//long _match = 0;    /* Smith-Waterman score for a match */
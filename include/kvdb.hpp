@@ -7,15 +7,18 @@
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/options.h"
+#include "rocksdb/table.h"
+#include "rocksdb/cache.h"
 
 class KeyValueDatabase {
 public:
-	KeyValueDatabase(std::string const &kvdbPath);
+	KeyValueDatabase(std::string const &kvdbPath, std::size_t mem_bytes = 0); // mem_bytes: block cache + memtables. 0 - RocksDB defaults
 	~KeyValueDatabase() { delete kvdb; }
 
 	void put(std::string key, std::string val);
 	std::string get(std::string key);
 	int clear(std::string dbPath);
+	void get_mem(std::size_t &block_cache, std::size_t &memtables); // memory held by RocksDB (see MemStats)
 private:
 	rocksdb::DB* kvdb;
 	rocksdb::Options options;
@@ -0,0 +1,57 @@
+#pragma once
+/**
+ * FILE: memstats.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Memory accounting per data structure. Used for sizing the index parts ('-m') and the
+ * number of threads from data rather than by trial and error.
+ *
+ * The values are collected at well defined points of the main thread (after an index part
+ * is loaded, after the part is processed) from the counters kept by the data structures
+ * themselves, so nothing is added to the per-read hot path except the queue byte counters.
+ *
+ * Peaks are kept per phase (align, postproc, report) and printed as a single line
+ * 'Memory peak [phase]: item=bytes ...' parsed by 'run.py --bench'.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <cstddef>
+
+// forward
+struct Index;
+class References;
+class KeyValueDatabase;
+struct Readstats;
+
+enum MemItem : int {
+	MEM_LOOKUP_TBL,     // Index::lookup_tbl
+	MEM_TRIE_NODES,     // burst trie nodes in the per 9-mer arenas
+	MEM_TRIE_BUCKETS,   // burst trie buckets in the per 9-mer arenas
+	MEM_POSITIONS_TBL,  // Index::positions_tbl including the seq_pos arrays
+	MEM_SEED_HASH,      // Index::seed_hash (small index parts only)
+	MEM_REF_SEQUENCES,  // References sequence pool
+	MEM_REF_HEADERS,    // References header pool
+	MEM_READ_QUEUE,     // reads waiting in the read queue (peak)
+	MEM_WRITE_QUEUE,    // reads waiting in the write queue (peak)
+	MEM_REORDER_BUF,    // reads buffered for the reordering (OPT_REORDER)
+	MEM_THREAD_SCRATCH, // per processor thread working read incl. seed hits (sum of the thread peaks)
+	MEM_KVDB_CACHE,     // RocksDB block cache
+	MEM_KVDB_MEMTABLES, // RocksDB memtables
+	MEM_OTU_MAP,        // Readstats::otu_map
+	MEM_NUM_ITEMS
+};
+
+class MemStats {
+public:
+	static void set(MemItem item, std::size_t bytes);
+	static void add(MemItem item, std::size_t bytes);
+	static void count(Index &index);
+	static void count(References &refs);
+	static void count(KeyValueDatabase &kvdb);
+	static void count(Readstats &readstats); // otu_map
+	static void start_phase(); // reset the peaks
+	static void check_budget(double max_mb); // warn if the accounted memory exceeds OPT_MAX_MEMORY. No-op if 0
+	static std::string report(const std::string &title); // current and peak values per item
+	static std::string report_peak(const std::string &phase); // single line of peaks since 'start_phase'
+};
@@ -73,6 +73,22 @@ OPT_THREP = "threp",
 OPT_DBG_PUT_DB = "dbg_put_db",
 OPT_TMPDIR = "tmpdir",
 OPT_INTERVAL = "interval",
+OPT_PERF = "perf",
+OPT_TRACE = "trace",
+OPT_SLOW_READ = "slow_read",
+OPT_MAX_MEMORY = "max_memory",
+OPT_HUGE_PAGES = "huge_pages",
+OPT_ESTIMATE = "estimate",
+OPT_MAX_CANDIDATES = "max_candidates",
+OPT_MAX_SW_CELLS = "max_sw_cells",
+OPT_MAX_READ_TIME = "max_read_time",
+OPT_DUST = "dust",
+OPT_REORDER = "reorder",
+OPT_IO_ENGINE = "io_engine",
+OPT_MAX_EE = "max_ee",
+OPT_SEED_MASK = "seed_mask",
+OPT_CLUSTER_ID = "cluster_id",
+OPT_ADAPTIVE_PASSES = "adaptive_passes",
 OPT_MAX_POS = "max_pos";
 
 // help strings
@@ -86,7 +102,7 @@ help_ref =
 	"Reference file (FASTA) absolute or relative path.\n"
 	"                                            Use mutliple times, once per a reference file\n",
 help_reads = 
-	"Raw reads file (FASTA/FASTQ/FASTA.GZ/FASTQ.GZ).\n"
+	"Raw reads file (FASTA/FASTQ/FASTA.GZ/FASTQ.GZ/FASTA.ZST/FASTQ.ZST/BAM).\n"
 	"                                            Use twice for files with paired reads\n",
 help_aligned = 
 	"Aligned reads file prefix [dir/][pfx]       WORKDIR/out/aligned\n"
@@ -289,6 +305,98 @@ help_m =
 	"                                            the index.\n",
 help_L = 
 	"Indexing: seed length.                                  18\n",
+help_perf = 
+	"Collect hardware performance counters (cycles,          False\n"
+	"                                            instructions, LLC/dTLB/branch misses) per\n"
+	"                                            thread and stage using perf_event_open.\n"
+	"                                            Linux only. Adds overhead. Disabled with a\n"
+	"                                            warning if the counters are not accessible.\n",
+help_trace = 
+	"Write a timeline of the run in Chrome trace-event JSON  None\n"
+	"                                            format (chrome://tracing, ui.perfetto.dev)\n"
+	"                                            into the given file e.g. '--trace trace.json'\n"
+	"                                            Spans: index build/load, references load,\n"
+	"                                            thread pool barriers, per-thread batches of\n"
+	"                                            reads, KVDB writes and report writes.\n",
+help_slow_read = 
+	"Log reads taking longer than the given number of        0\n"
+	"                                            milliseconds to align against an index part\n"
+	"                                            into 'WORKDIR/out/slow_reads.tsv' together with\n"
+	"                                            passes, windows searched, readhit, seed hits,\n"
+	"                                            candidate references and SW calls.\n"
+	"                                            0 - disabled.\n",
+help_max_memory = 
+	"Memory budget (in Mbytes) for the whole run.            0\n"
+	"                                            Sets the index part size (unless '-m' given),\n"
+	"                                            caps the read/write queues, sizes the KVDB\n"
+	"                                            caches, and spills the OTU map to disk when\n"
+	"                                            its share is exceeded. 0 - no limit.\n",
+help_huge_pages = 
+	"Huge pages for the index and references arenas:      thp\n"
+	"                                            off     - regular pages\n"
+	"                                            thp     - transparent huge pages (madvise)\n"
+	"                                            hugetlb - explicit huge pages (hugetlbfs pool),\n"
+	"                                                      falls back to 'thp' if the pool is empty\n",
+help_estimate = 
+	"Estimate the fraction of reads matching each database   0\n"
+	"                                            from a random sample of the reads, searched in\n"
+	"                                            growing batches until the 95% confidence\n"
+	"                                            intervals are narrower than the given width\n"
+	"                                            e.g. 0.01. Only the log is written. 0 - off\n",
+help_max_candidates = 
+	"Work budget: max candidate references per read          0\n"
+	"                                            examined in an index part (both strands).\n"
+	"                                            The read keeps the best alignments found so far\n"
+	"                                            and is counted as over budget. 0 - no limit\n",
+help_max_sw_cells = 
+	"Work budget: max Smith-Waterman cells (read x ref       0\n"
+	"                                            length) per read in an index part. 0 - no limit\n",
+help_max_read_time = 
+	"Work budget: max microseconds per read in an index      0\n"
+	"                                            part. 0 - no limit\n",
+help_dust = 
+	"Skip low complexity seed windows with a DUST score      0\n"
+	"                                            above the value e.g. 2 (homopolymer: 8,\n"
+	"                                            dinucleotide repeat: ~3.7 for L = 18).\n"
+	"                                            Applied to the reads and when building the\n"
+	"                                            index. 0 - off\n",
+help_reorder = 
+	"Buffer this many reads and search them sorted by        0\n"
+	"                                            their minimizer, so that similar reads hit the\n"
+	"                                            same index and reference regions back to back.\n"
+	"                                            Fewer with '--max_memory' (5% share). The\n"
+	"                                            output order is not affected. 0 - off\n",
+help_io_engine = 
+	"I/O of the reads, index, references and output          stream\n"
+	"                                            files. stream - blocking file streams\n"
+	"                                            pread  - 1 MB reads/writes, 4 in flight\n"
+	"                                            uring  - as 'pread' with Linux io_uring, falls\n"
+	"                                                     back to 'pread' if not available\n",
+help_max_ee = 
+	"Skip seed windows with expected errors (sum of          0\n"
+	"                                            10^(-Q/10) over the window) above the value.\n"
+	"                                            FASTQ/BAM reads only e.g. 2. 0 - off\n",
+help_adaptive_passes = 
+	"Run a denser seed search pass ('passes') only if it     False\n"
+	"                                            can align the read: the hits so far plus its\n"
+	"                                            new windows with a seed in the index reach\n"
+	"                                            'num_seeds'. No loss of sensitivity\n",
+help_seed_mask = 
+	"Indexing: spaced seed mask of '1' (compared) and '0'    None\n"
+	"                                            (any nt) e.g. 11011011011011011011011011.\n"
+	"                                            The number of '1' is the seed length ('L').\n"
+	"                                            Stored with the index, use a separate\n"
+	"                                            index directory ('idx-dir')\n",
+help_cluster_id = 
+	"Indexing: cluster the references at this identity       0\n"
+	"                                            e.g. 0.97 and index the cluster centroids only.\n"
+	"                                            The members are aligned when their centroid\n"
+	"                                            aligns, if more than the first or the best\n"
+	"                                            alignment, SAM/BLAST output, OTU picking or\n"
+	"                                            '--id'/'--coverage' is asked for. Otherwise a\n"
+	"                                            read is classified by the centroid alignment.\n"
+	"                                            A read not aligning to the centroid is not\n"
+	"                                            tried on the members. 0 - off\n",
 help_max_pos = 
 	"Indexing: maximum (integer) number of positions to store  1000\n"
 	"                                            for each unique L-mer. If 0 all positions are stored.\n"
@@ -375,6 +483,7 @@ public:
 	bool is_pid = false; // --pid add pid to output file names
 	bool is_cmd = false; // OPT_CMD was selected i.e. start interactive session
 	bool is_dbg_put_kvdb = false; // OPT_DBG_PUT_DB: DEBUG. if True - do Not put records into Key-value DB. Debugging Memory Consumption.
+	bool is_perf = false; // OPT_PERF collect hardware performance counters per thread and pipeline stage
 
 	// Option derived Flags
 	bool is_as_percent = false; // derived from OPT_EDGES
@@ -382,7 +491,8 @@ public:
 	// Other flags
 	bool exit_early = false; // TODO: has no action? Flag to exit processing when either the reads or the reference file is empty or not FASTA/FASTQ
 	bool is_index_built = false; // flags the index is built and ready for use. TODO: this is no Option flag is any respect. Move to a more appropriate place.
-	bool is_gz = false; // flags reads file is compressed and can be read. TODO: no Option related flag. Move to a proper place.
+	enum ZIP_FORMAT { ZIP_NONE, ZIP_GZIP, ZIP_ZSTD, ZIP_BAM }; // ZIP_BAM - BGZF compressed BAM records, not lines
+	std::vector<ZIP_FORMAT> readfiles_zip; // compression of each of the 'readfiles'. Detected from the file content in 'opt_reads'
 	bool is_paired = false; // flags the reads are paired
 
 	std::filesystem::path workdir; // Directory for index, KVDB, Output
@@ -391,6 +501,8 @@ public:
 	std::filesystem::path outdir;
 	std::filesystem::path aligned_pfx; // aligned reads output file prefix [dir/][pfx]
 	std::filesystem::path other_pfx; // non-aligned reads output file prefix [dir/][pfx]
+	std::filesystem::path trace_file; // OPT_TRACE timeline output file. Tracing is off if empty
+	int slow_read_ms = 0; // OPT_SLOW_READ slow read log threshold (ms). Disabled if 0
 	std::string cmdline;
 
 	int num_read_thread = 1; // number of threads reading the Reads file.
@@ -402,6 +514,24 @@ public:
 	int num_proc_thread_rep = 1; // number of report processor threads
 
 	int queue_size_max = 100; // max number of Reads in the Read and Write queues. 10 works OK.
+	double max_memory = 0; // OPT_MAX_MEMORY memory budget (MB). 0 - no limit
+	std::size_t queue_max_bytes = 0; // derived from OPT_MAX_MEMORY: max bytes of reads held by a queue. 0 - no limit
+	std::size_t kvdb_mem_bytes = 0; // derived from OPT_MAX_MEMORY: RocksDB block cache + memtables. 0 - RocksDB defaults
+	std::size_t otu_map_max_bytes = 0; // derived from OPT_MAX_MEMORY: OTU map size that triggers a spill to disk. 0 - no limit
+	std::size_t reorder_max_bytes = 0; // derived from OPT_MAX_MEMORY: max bytes of reads buffered by OPT_REORDER. 0 - no limit
+	std::string huge_pages = "thp"; // OPT_HUGE_PAGES page backing of the index arenas: off | thp | hugetlb
+	double estimate_width = 0; // OPT_ESTIMATE target width of the confidence intervals in the estimate mode. 0 - off
+	uint32_t max_candidates = 0; // OPT_MAX_CANDIDATES per read work budget: candidate references. 0 - no limit
+	uint64_t max_sw_cells = 0; // OPT_MAX_SW_CELLS per read work budget: Smith-Waterman cells. 0 - no limit
+	uint32_t max_read_time = 0; // OPT_MAX_READ_TIME per read work budget: microseconds. 0 - no limit
+	bool is_read_budget = false; // any of the above is set
+	double dust = 0; // OPT_DUST mask the seed windows with DUST score above this value. 0 - off
+	uint32_t reorder = 0; // OPT_REORDER number of reads sorted by minimizer before the search. 0 - off
+	std::string io_engine = "stream"; // OPT_IO_ENGINE stream | pread | uring
+	double max_ee = 0; // OPT_MAX_EE skip the seed windows with more expected errors. 0 - off
+	std::string seed_mask; // OPT_SEED_MASK spaced seed. Empty - contiguous seed
+	double cluster_id = 0; // OPT_CLUSTER_ID index the centroids of the reference clusters at this identity. 0 - off
+	bool is_adaptive_passes = false; // OPT_ADAPTIVE_PASSES skip the denser passes that cannot align the read
 
 	int32_t num_alignments = -1; // [3] help_num_alignments
 	int32_t min_lis = -1; // OPT_MIN_LIS search all alignments having the first N longest LIS
@@ -451,6 +581,7 @@ private:
 	void validate_kvdbdir(); // called from validate
 	void validate_aligned_pfx();
 	void validate_other_pfx();
+	void validate_max_memory(); // split the memory budget. Called from validate
 	void opt_sort();
 
 	void opt_reads(const std::string &val);
@@ -490,6 +621,19 @@ private:
 	void opt_threads(const std::string &val);
 	void opt_thpp(const std::string &val); // post-proc threads --thpp 1:1
 	void opt_threp(const std::string &val); // report threads --threp 1:1 
+	void opt_max_memory(const std::string &val);
+	void opt_huge_pages(const std::string &val);
+	void opt_estimate(const std::string &val);
+	void opt_max_candidates(const std::string &val);
+	void opt_max_sw_cells(const std::string &val);
+	void opt_max_read_time(const std::string &val);
+	void opt_dust(const std::string &val);
+	void opt_reorder(const std::string &val);
+	void opt_io_engine(const std::string &val);
+	void opt_max_ee(const std::string &val);
+	void opt_seed_mask(const std::string &val);
+	void opt_cluster_id(const std::string &val);
+	void opt_adaptive_passes(const std::string &val);
 	void opt_a(const std::string &val);
 	void opt_e(const std::string &val); // opt_e_Evalue
 	void opt_F(const std::string &val); // opt_F_ForwardOnly
@@ -509,6 +653,9 @@ private:
 	void opt_max_pos(const std::string &val);
 
 	void opt_default(const std::string &opt);
+	void opt_perf(const std::string &val);
+	void opt_trace(const std::string &val);
+	void opt_slow_read(const std::string &val);
 	void opt_dbg_put_db(const std::string &opt);
 	void opt_unknown(char **argv, int &narg, char * opt);
 
@@ -532,7 +679,7 @@ private:
 	std::multimap<std::string, std::string> mopt;
 
 	// OPTIONS Map - specifies all possible options
-	const std::array<opt_6_tuple, 48> options = {
+	const std::array<opt_6_tuple, 64> options = {
 		std::make_tuple(OPT_REF,            "PATH",        COMMON,      true,  help_ref, &Runopts::opt_ref),
 		std::make_tuple(OPT_READS,          "PATH",        COMMON,      true,  help_reads, &Runopts::opt_reads),
 		std::make_tuple(OPT_WORKDIR,        "PATH",        COMMON,      false, help_workdir, &Runopts::opt_workdir),
@@ -571,14 +718,30 @@ private:
 		std::make_tuple(OPT_PID,            "BOOL",        ADVANCED,    false, help_pid, &Runopts::opt_pid),
 		std::make_tuple(OPT_A,              "INT",         ADVANCED,    false, help_a, &Runopts::opt_a),
 		std::make_tuple(OPT_THREADS,        "INT",         ADVANCED,    false, help_threads, &Runopts::opt_threads),
+		std::make_tuple(OPT_MAX_MEMORY,     "INT",         ADVANCED,    false, help_max_memory, &Runopts::opt_max_memory),
+		std::make_tuple(OPT_HUGE_PAGES,     "STR",         ADVANCED,    false, help_huge_pages, &Runopts::opt_huge_pages),
+		std::make_tuple(OPT_ESTIMATE,       "DOUBLE",      ADVANCED,    false, help_estimate, &Runopts::opt_estimate),
+		std::make_tuple(OPT_MAX_CANDIDATES, "INT",         ADVANCED,    false, help_max_candidates, &Runopts::opt_max_candidates),
+		std::make_tuple(OPT_MAX_SW_CELLS,   "INT",         ADVANCED,    false, help_max_sw_cells, &Runopts::opt_max_sw_cells),
+		std::make_tuple(OPT_MAX_READ_TIME,  "INT",         ADVANCED,    false, help_max_read_time, &Runopts::opt_max_read_time),
+		std::make_tuple(OPT_DUST,           "DOUBLE",      ADVANCED,    false, help_dust, &Runopts::opt_dust),
+		std::make_tuple(OPT_REORDER,        "INT",         ADVANCED,    false, help_reorder, &Runopts::opt_reorder),
+		std::make_tuple(OPT_IO_ENGINE,      "STR",         ADVANCED,    false, help_io_engine, &Runopts::opt_io_engine),
+		std::make_tuple(OPT_MAX_EE,         "DOUBLE",      ADVANCED,    false, help_max_ee, &Runopts::opt_max_ee),
+		std::make_tuple(OPT_ADAPTIVE_PASSES,"BOOL",        ADVANCED,    false, help_adaptive_passes, &Runopts::opt_adaptive_passes),
 		std::make_tuple(OPT_L,              "DOUBLE",      INDEXING,    false, help_L, &Runopts::opt_L),
 		std::make_tuple(OPT_M,              "DOUBLE",      INDEXING,    false, help_m, &Runopts::opt_m),
 		std::make_tuple(OPT_V,              "BOOL",        INDEXING,    false, help_v, &Runopts::opt_v),
 		std::make_tuple(OPT_INTERVAL,       "INT",         INDEXING,    false, help_interval, &Runopts::opt_interval),
 		std::make_tuple(OPT_MAX_POS,        "INT",         INDEXING,    false, help_max_pos, &Runopts::opt_max_pos),
+		std::make_tuple(OPT_SEED_MASK,      "STR",         INDEXING,    false, help_seed_mask, &Runopts::opt_seed_mask),
+		std::make_tuple(OPT_CLUSTER_ID,     "DOUBLE",      INDEXING,    false, help_cluster_id, &Runopts::opt_cluster_id),
 		std::make_tuple(OPT_H,              "BOOL",        HELP,        false, help_h, &Runopts::opt_h),
 		std::make_tuple(OPT_VERSION,        "BOOL",        HELP,        false, help_version, &Runopts::opt_version),
 		std::make_tuple(OPT_DBG_PUT_DB,     "BOOL",        DEVELOPER,   false, help_dbg_put_db, &Runopts::opt_dbg_put_db),
+		std::make_tuple(OPT_PERF,           "BOOL",        DEVELOPER,   false, help_perf, &Runopts::opt_perf),
+		std::make_tuple(OPT_TRACE,          "PATH",        DEVELOPER,   false, help_trace, &Runopts::opt_trace),
+		std::make_tuple(OPT_SLOW_READ,      "INT",         DEVELOPER,   false, help_slow_read, &Runopts::opt_slow_read),
 		std::make_tuple(OPT_CMD,            "BOOL",        DEVELOPER,   false, help_cmd, &Runopts::opt_cmd),
 		std::make_tuple(OPT_TASK,           "INT",         DEVELOPER,   false, help_task, &Runopts::opt_task)
 		//std::make_tuple(OPT_THPP,           "INT:INT",     DEVELOPER,   false, help_thpp, &Runopts::opt_thpp),
@@ -38,6 +38,7 @@
 
 #include "common.hpp"
 #include "kvdb.hpp"
+#include "aio.hpp"
 
 // forward
 struct Index;
@@ -71,15 +72,19 @@ public:
 	uint64_t all_reads_len;
 	size_t total_otu;
 	std::vector<std::pair<std::string, float>> db_matches;
+	uint64_t reads_over_budget; // searches that used up the per read work budget (OPT_MAX_CANDIDATES etc.)
+	uint64_t est_sampled; // OPT_ESTIMATE: number of sampled reads the results are extrapolated from. 0 - not an estimate
+	std::pair<float, float> mapped_ci; // OPT_ESTIMATE: 95% confidence interval (%) of 'total_reads_mapped'
+	std::vector<std::pair<float, float>> db_ci; // OPT_ESTIMATE: 95% confidence intervals (%) of 'db_matches'
 };
 
 class Output {
 public:
 	// output streams
-	std::vector<std::ofstream> aligned_os; // fasta/q    20200127 2 files if 'out2', 1 file otherwise
-	std::vector<std::ofstream> other_os; // fasta/q non-aligned   20200127 2 files if 'out2', 1 file otherwise
-	std::ofstream sam_os; // SAM
-	std::ofstream blast_os; // BLAST
+	std::vector<AioOfstream> aligned_os; // fasta/q    20200127 2 files if 'out2', 1 file otherwise
+	std::vector<AioOfstream> other_os; // fasta/q non-aligned   20200127 2 files if 'out2', 1 file otherwise
+	AioOfstream sam_os; // SAM
+	AioOfstream blast_os; // BLAST
 	std::ofstream log_os;
 	std::ofstream denovo_os;
 	std::ofstream biom_os;
@@ -124,7 +129,7 @@ public:
 
 private:
 	void init(Runopts & opts, Readstats & readstats);
-	void write_a_read(std::ofstream& strm, Read& read);
+	void write_a_read(std::ostream& strm, Read& read);
 
 }; // ~class Output
 
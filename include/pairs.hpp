@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * FILE: pairs.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Paired-end early exit for '--paired_in' / '--paired_out'.
+ *
+ * The destination (aligned | other) of a pair under these options is decided by one mate:
+ *   paired_in  - the pair is 'aligned' as soon as either mate aligns (in any index part)
+ *   paired_out - the pair is 'other' as soon as either mate fails i.e. did not align
+ *                after the last index part was searched
+ * The decision is recorded in a bit per pair shared by the Processor threads. The mate that
+ * is still to be searched is skipped when popped, or aborted between its strands.
+ *
+ * Only enabled when FASTA/Q splitting is the only output depending on the alignments
+ * (no SAM, BLAST, OTU map or de novo), as the skipped mate gets no alignments.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <cstdint>
+#include <cstddef>
+
+// forward
+struct Runopts;
+class Read;
+
+class Pairs {
+public:
+	static void open(Runopts &opts, uint64_t num_reads); // called from main thread before the alignment
+	static void close(); // prints the summary
+	static bool is_on();
+
+	static bool is_decided(const Read &read); // the destination of the read's pair is known
+	static void update(const Read &read, bool is_last_part); // record the decision made by the read, if any
+	static void skipped(); // count a skipped mate
+};
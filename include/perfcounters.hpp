@@ -0,0 +1,65 @@
+#pragma once
+/**
+ * FILE: perfcounters.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Optional hardware performance counters ('--perf') collected per pipeline stage and per thread
+ * using Linux 'perf_event_open'.
+ *
+ * Each worker job (ReadControl, Processor, Writer) creates a PerfCounters object, which opens
+ * one counter group for the calling thread and registers itself as the thread's current counters.
+ * Code on the hot path marks stages with 'PerfScope', which is a no-op when no counters are
+ * active for the thread. Stages nest: the counts accrued inside a nested stage are attributed to
+ * the nested stage only (e.g. SW inside LIS inside SEED).
+ *
+ * When the counters cannot be opened (non-Linux, 'perf_event_paranoid', containers, VMs without PMU)
+ * a single warning is printed and the collection is disabled. Individual events that are not
+ * supported by the CPU are reported as 'n/a'.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+enum class PerfStage : int { OTHER, SEED, LIS, SW, PARSE, KVDB, NUM_STAGES };
+enum PerfEvent : int { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_DTLB_MISSES, PERF_BRANCH_MISSES, PERF_NUM_EVENTS };
+
+typedef std::array<uint64_t, PERF_NUM_EVENTS> perf_values;
+
+class PerfCounters {
+public:
+	PerfCounters(const std::string &id, bool is_enabled);
+	~PerfCounters(); // publishes the collected counts into the process wide registry
+
+	void push(PerfStage stage);
+	void pop();
+	void swap(PerfStage stage); // pop + push in one counters read
+	bool is_active() { return group_fd >= 0; }
+
+	static std::string report(); // per thread and per stage table. Empty if nothing was collected.
+	static void reset();
+
+private:
+	bool read_group(perf_values &vals);
+	void account();
+
+private:
+	std::string id; // thread (job) id e.g. 'proc_0'
+	int group_fd = -1;
+	std::array<int, PERF_NUM_EVENTS> fds; // -1 if the event is not available
+	perf_values last; // counter values at the last stage switch
+	std::array<perf_values, static_cast<int>(PerfStage::NUM_STAGES)> counts;
+	std::vector<PerfStage> stages; // stack of active stages
+	PerfCounters *prev = nullptr; // counters of the thread before this object was created
+};
+
+/* RAII stage marker. Cheap when '--perf' is off - only a thread_local pointer check */
+class PerfScope {
+public:
+	PerfScope(PerfStage stage);
+	~PerfScope();
+private:
+	PerfCounters *pc;
+};
@@ -18,6 +18,7 @@ class References;
 class Output;
 struct Readstats;
 class Refstats;
+struct AlignScratch;
 
 /* 
  * performs alignment
@@ -35,7 +36,7 @@ public:
 		Readstats & readstats, 
 		Refstats & refstats,
 		//std::function<void(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read)> callback
-		void(*callback)(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read, bool isLastStrand)
+		void(*callback)(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read, AlignScratch & scratch, bool isLastStrand)
 	) :
 		id(id),
 		readQueue(readQueue),
@@ -54,7 +55,7 @@ public:
 protected:
 	void run();
 	//std::function<void(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read)> callback;
-	void(*callback)(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read, bool isLastStrand);
+	void(*callback)(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats, Refstats & refstats, Read & read, AlignScratch & scratch, bool isLastStrand);
 
 protected:
 	std::string id;
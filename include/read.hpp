@@ -78,6 +78,7 @@ public:
 	int32_t num_alignments; // number of alignments to output per read
 	uint32_t readhit; // number of seeds matches between read and database. (? readhit == id_win_hits.size)
 	int32_t best; // init with opts.min_lis, see 'this.init'. Don't DB store/restore (bug 51).
+	bool is_over_budget; // the per read work budget was used up in an index part (see ReadBudget). The alignments are the best found so far
 
 	std::vector<id_win> id_win_hits; // [1] positions of hits on the reference sequence in given index/part
 
@@ -110,4 +111,6 @@ public:
 	void calcMismatchGapId(References &refs, int alignIdx, uint32_t &mismatches, uint32_t &gaps, uint32_t &id);
 	std::string getSeqId();
 	uint32_t hashKmer(uint32_t pos, uint32_t len);
+	void expected_errors(uint32_t win_len, std::vector<float> &win_ee) const; // per window start. OPT_MAX_EE
+	std::size_t mem_size() const; // approximate memory held by the read (by content size). See MemStats
 }; // ~class Read
@@ -8,11 +8,13 @@
 
 #include <string>
 #include <fstream> // std::ifstream
+#include <istream>
 
 #include "readsqueue.hpp"
 #include "kvdb.hpp"
 #include "options.hpp"
 #include "gzip.hpp"
+#include "bam.hpp"
 
  // forward
 class Read;
@@ -22,23 +24,27 @@ class Read;
  */
 class Reader {
 public:
-	Reader(std::string id, bool is_gzipped);
+	Reader(std::string id, Runopts::ZIP_FORMAT zip);
 	~Reader();
 
-	Read nextread(std::ifstream &ifs, const uint8_t readsfile_idx, Runopts & opts);
-	bool nextread(std::ifstream &ifs, const std::string &readsfile, std::string &seq);
+	Read nextread(std::istream &ifs, const uint8_t readsfile_idx, Runopts & opts);
+	bool nextread(std::istream &ifs, const std::string &readsfile, std::string &seq);
 	void reset();
-	static bool hasnext(std::ifstream& ifs);
+	static bool hasnext(std::istream& ifs);
 	static bool loadReadByIdx(Runopts & opts, Read & read);
 	static bool loadReadById(Runopts & opts, Read & read);
 
 public:
 	bool is_done = false; // flags end of reads stream
 
+private:
+	Read nextread_bam(std::istream &ifs, const uint8_t readsfile_idx, Runopts & opts);
+
 private:
 	std::string id;
-	bool is_gzipped;
+	Runopts::ZIP_FORMAT zip;
 	Gzip gzip;
+	Bam bam; // ZIP_BAM
 	unsigned int read_count; // count of reads
 	unsigned int line_count; // count of non-empty lines in the reads file
 	int last_count;
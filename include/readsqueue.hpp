@@ -31,6 +31,9 @@ class ReadsQueue
 	std::atomic_uint numPushed; // shared
 	std::atomic_uint numPopped; // shared
 	std::atomic_uint pushers; // counter of threads that push reads on this queue. When zero - the pushing is over.
+	std::atomic<std::size_t> num_bytes; // approximate memory held by the queued reads. See Read::mem_size
+	std::atomic<std::size_t> peak_bytes; // peak of 'num_bytes' since the last 'reset'
+	std::size_t max_bytes = 0; // push blocks while the queue holds more than this. 0 - no limit. See OPT_MAX_MEMORY
 #ifdef LOCKQEUEU
 	std::queue<Read> recs; // shared: Reader & Processors, Writer & Processors
 #else
@@ -39,6 +42,9 @@ class ReadsQueue
 
 	std::mutex qlock; // lock for push/pop on queue
 	std::condition_variable cvQueue;
+	std::mutex budget_lock; // push waiting for the memory budget (max_bytes)
+	std::condition_variable cvBudget; // notified by pop when 'num_bytes' drops and a push waits
+	std::atomic_uint budget_waiters; // pushers waiting on 'cvBudget'
 
 public:
 	ReadsQueue(std::string id, int capacity, int numPushers)
@@ -47,7 +53,10 @@ public:
 		capacity(capacity),
 		numPushed(0),
 		numPopped(0),
-		pushers(numPushers)
+		pushers(numPushers),
+		num_bytes(0),
+		peak_bytes(0),
+		budget_waiters(0)
 #ifndef LOCKQEUEU
 		,
 		recs(capacity) // set initial capacity
@@ -74,6 +83,18 @@ public:
 	 */
 	void push(Read & rec) 
 	{
+		std::size_t rec_bytes = rec.mem_size();
+		// memory budget: wait for the consumers. A single read is always accepted to guarantee progress.
+		if (max_bytes > 0 && num_bytes.load() > 0 && num_bytes.load() + rec_bytes > max_bytes)
+		{
+			std::unique_lock<std::mutex> lmb(budget_lock);
+			++budget_waiters;
+			cvBudget.wait(lmb, [this, rec_bytes] { return num_bytes.load() == 0 || num_bytes.load() + rec_bytes <= max_bytes; });
+			--budget_waiters;
+		}
+
+		std::size_t bytes = (num_bytes += rec_bytes); // queue bytes including this read
+		for (std::size_t peak = peak_bytes.load(); bytes > peak && !peak_bytes.compare_exchange_weak(peak, bytes);) {}
 #ifdef LOCKQEUEU
 		std::unique_lock<std::mutex> lmq(qlock);
 		cvQueue.wait(lmq, [this] { return recs.size() < capacity; });
@@ -102,6 +123,8 @@ public:
 			rec = recs.front();
 			recs.pop();
 			++numPopped;
+			num_bytes -= rec.mem_size();
+			notify_budget();
 			if (numPopped.load() % 100000 == 0)
 			{
 				std::stringstream ss;
@@ -112,7 +135,12 @@ public:
 		cvQueue.notify_one();
 #else
 		bool found = recs.try_dequeue(rec);
-		if (found) ++numPopped;
+		if (found)
+		{
+			++numPopped;
+			num_bytes -= rec.mem_size();
+			notify_budget();
+		}
 #endif
 		return rec;
 	}
@@ -134,6 +162,7 @@ public:
 	void reset(int nPushers) {
 		std::stringstream ss;
 		pushers = nPushers;
+		peak_bytes = num_bytes.load();
 		ss << STAMP << "[" << id << "] pushers: [" << pushers.load() << "]" << std::endl;
 		std::cout << ss.str();
 	}
@@ -158,6 +187,31 @@ public:
 		cvQueue.notify_one();
 	}
 
+	/*
+	 * wake the pushers waiting for the memory budget. 'num_bytes' was decremented before 'budget_waiters'
+	 * is read, so a pusher not counted yet checks the decremented value. The lock orders the notification
+	 * after the wait of a counted pusher
+	 */
+	void notify_budget()
+	{
+		if (budget_waiters.load() == 0)
+			return;
+		{
+			std::lock_guard<std::mutex> lmb(budget_lock);
+		}
+		cvBudget.notify_all();
+	}
+
+	std::size_t bytes_peak()
+	{
+		return peak_bytes.load();
+	}
+
+	void set_max_bytes(std::size_t bytes)
+	{
+		max_bytes = bytes;
+	}
+
 	unsigned int getPushers()
 	{
 		return pushers.load();
@@ -9,10 +9,13 @@
 
 #include <cstdint>
 #include <string>
+#include <istream>
 #include <vector>
 #include <map>
 #include <mutex>
 #include <atomic>
+#include <random>
+#include <filesystem>
 
 #include "common.hpp"
 #include "options.hpp"
@@ -20,6 +23,17 @@
 // forward
 class KeyValueDatabase;
 
+// a read of the random sample for OPT_ESTIMATE. See 'Readstats::sample'
+struct SampledRead
+{
+	uint8_t readfile_idx = 0;
+	std::size_t read_num = 0; // in the reads file
+	Format format = Format::FASTA;
+	std::string header;
+	std::string sequence;
+	std::string quality;
+};
+
 /*
  * 1. 'all_reads_count' - Should be known before processing and index loading. 
  * 2. 'total_reads_mapped_cov'
@@ -35,7 +49,8 @@ class KeyValueDatabase;
  *			calculated after alignment is done on all reads
  *			Setter: 'computeStats' post-processing callback
  *			User: 'printOtuMap'
- *			TODO: Store in DB? Can be very big.
+ *			Can be very big: with OPT_MAX_MEMORY the map is spilled to sorted run files in WORKDIR/out
+ *			when over 'otu_map_max_bytes' and the runs are merged by 'printOtuMap'.
  */
 struct Readstats 
 {
@@ -46,6 +61,17 @@ struct Readstats
 	std::atomic<uint32_t> max_read_len; // length of the longest Read in the Reads file. 'parallelTraversalJob'
 	std::atomic<uint64_t> total_reads_aligned; // total number of reads passing E-value threshold. Set in 'compute_lis_alignment'
 	std::atomic<uint64_t> total_reads_mapped_cov; // [2] total number of reads mapped passing E-value, %id, %query coverage thresholds
+	std::atomic<uint64_t> reads_over_budget; // searches (read x index part) that used up the per read work budget. 'Processor::run'
+	std::atomic<uint64_t> windows_masked; // low complexity read windows skipped in the seed search (OPT_DUST). 'alignmentCb'. Not stored
+	std::atomic<uint64_t> windows_low_quality; // read windows with too many expected errors skipped in the seed search (OPT_MAX_EE). 'alignmentCb'. Not stored
+	std::atomic<uint64_t> cluster_members_tried; // cluster members aligned to as their centroid aligned (OPT_CLUSTER_ID). 'compute_lis_alignment'. Not stored
+	std::atomic<uint64_t> cluster_members_aligned; // of those passing the minimal score. Not stored
+	std::atomic<uint64_t> sw_8bit; // Smith-Waterman alignments planned 8-bit only: the score cannot saturate. 'compute_lis_alignment'. Not stored
+	std::atomic<uint64_t> sw_16bit; // planned 16-bit only: the seeds predict a saturating 8-bit score
+	std::atomic<uint64_t> sw_reruns_avoided; // of those saturating indeed
+	std::atomic<uint64_t> sw_reruns; // planned 8-bit with the 16-bit fallback, and rerun with 16-bit
+	std::atomic<uint64_t> near_exact_aligned; // alignments on the LIS diagonal made without Smith-Waterman. 'compute_lis_alignment'. Not stored
+	std::atomic<uint64_t> passes_skipped; // seed search passes not run as they cannot align the read (OPT_ADAPTIVE_PASSES). 'alignmentCb'. Not stored
 
 	uint64_t all_reads_count; // [1] total number of reads in file. Non-sync. 'Readstats::calculate'
 	uint64_t all_reads_len; // total number of nucleotides in all reads i.e. sum of length of All read sequences 'Readstats::calculate'
@@ -53,14 +79,27 @@ struct Readstats
 
 	std::vector<uint64_t> reads_matched_per_db; // [3] total number of reads matched for each database. `compute_lis_alignment`.
 	std::map<std::string, std::vector<std::string>> otu_map; // [5] Populated in 'computeStats' post-processor callback
+	std::mutex otu_map_lock; // synchronize 'pushOtuMap'
+	std::size_t otu_map_bytes; // approximate memory held by 'otu_map'. See MemStats
+	std::size_t otu_map_max_bytes; // spill 'otu_map' to disk when exceeding this size. 0 - no limit. Runopts::otu_map_max_bytes
+	std::filesystem::path otu_spill_pfx; // WORKDIR/out/otu_map_spill_
+	std::vector<std::filesystem::path> otu_spill_files; // sorted runs of 'otu_map'
+	std::size_t total_otu; // number of OTUs. Set in 'printOtuMap'
 
 	bool is_stats_calc; // flags 'computeStats' was called. Set in 'postProcess'
 	bool is_total_reads_mapped_cov; // flag 'total_reads_mapped_cov' was calculated (so no need to calculate no more)
 
+	// OPT_ESTIMATE uniform random sample of the reads of all the files (reservoir), taken by 'calculate'
+	std::vector<SampledRead> sample;
+	std::size_t sample_max; // 0 - no sample
+	std::mt19937_64 sample_rng;
+
 	Readstats(Runopts & opts, KeyValueDatabase &kvdb);
 	~Readstats() {}
 
 	void calculate(Runopts &opts); // calculate statistics from readsfile
+	void calculate_bam(std::istream &ifs, const std::string &readfile, uint8_t readfile_idx); // BAM readsfile
+	SampledRead * sample_slot(uint64_t read_count, uint8_t readfile_idx, std::size_t read_num); // OPT_ESTIMATE
 	void calcSuffix(Runopts &opts);
 	std::string toBstring();
 	std::string toString();
@@ -68,5 +107,7 @@ struct Readstats
 	void store_to_db(KeyValueDatabase & kvdb);
 	void pushOtuMap(std::string & ref_seq_str, std::string & read_seq_str);
 	void printOtuMap(std::string otumapfile);
+	void spillOtuMap(); // write 'otu_map' to a sorted run file and clear it. Call under 'otu_map_lock'
+	std::size_t otu_count(); // number of OTUs. Valid after 'printOtuMap'
 	void set_is_total_reads_mapped_cov();
 }; // ~struct Readstats
@@ -0,0 +1,71 @@
+#pragma once
+/**
+ * FILE: refclusters.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Clusters of near identical references of an index part (OPT_CLUSTER_ID).
+ *
+ * The rRNA databases are highly redundant: most of the seed hits and Smith-Waterman alignments of
+ * a read are on the members of one cluster. With OPT_CLUSTER_ID the index is built of the cluster
+ * centroids only (level one). The members stay in the references of the part and are aligned only
+ * when their centroid aligned (level two, see 'compute_lis_alignment').
+ *
+ * The clustering is greedy in the reference file order: a reference joins the centroid sharing the
+ * most of its sampled k-mers if the shared fraction is at least id^CLUSTER_K (the expected fraction
+ * at the identity 'id') and the length ratio is at least 'id'. Otherwise it is a new centroid.
+ * The k-mers are sampled by the hash value (1 in 2^CLUSTER_SAMPLE_BITS), so that the same k-mers are
+ * sampled on all the references. The k-mers of more than CLUSTER_MAX_CENTROIDS centroids (conserved
+ * regions) are not counted: they do not tell the centroids apart.
+ *
+ * File 'IDX_PFX.clust_PART.dat':
+ *   uint32_t  number of references N
+ *   uint32_t  centroid [N]. Own number for a centroid
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#define CLUSTER_K 16 /* k-mer length of the sketches */
+#define CLUSTER_SAMPLE_BITS 3 /* 1 in 8 k-mers sampled */
+#define CLUSTER_MAX_CENTROIDS 64 /* k-mers of more centroids are not counted */
+
+class RefClusters {
+public:
+	explicit RefClusters(double min_id = 0) : min_id(min_id) {}
+
+	// build: cluster the next reference of the part. Returns its centroid
+	uint32_t add(const unsigned char *seq, uint32_t len);
+	bool is_member(uint32_t ref) const { return ref < centroid_of.size() && centroid_of[ref] != ref; }
+	bool store(const std::string &file) const;
+
+	// search: false if the file is missing or does not match the part
+	bool load(const std::string &file, uint32_t numseq);
+	void clear();
+	bool is_loaded() const { return !member_offsets.empty(); }
+	std::size_t size() const { return centroid_of.size(); } // references
+	std::size_t num_centroids() const { return centroids; }
+
+	// members of the centroid 'ref' excluding the centroid itself
+	uint32_t num_members(uint32_t ref) const { return is_loaded() ? member_offsets[ref + 1] - member_offsets[ref] : 0; }
+	const uint32_t * members(uint32_t ref) const { return member_ids.data() + member_offsets[ref]; }
+
+private:
+	double min_id;
+	std::size_t centroids = 0;
+	std::vector<uint32_t> centroid_of; // centroid per reference
+
+	// build
+	std::unordered_map<uint32_t, std::vector<uint32_t>> sketch_tbl; // sampled k-mer : centroids
+	std::vector<uint32_t> lens; // reference lengths
+	std::vector<uint32_t> shared; // sampled k-mers shared with the reference being added. Indexed by centroid, kept zeroed
+	std::vector<uint32_t> touched; // centroids with non-zero 'shared'
+	std::vector<uint32_t> sketch; // sampled k-mers of the reference being added
+
+	// search
+	std::vector<uint32_t> member_offsets; // members of the centroid 'i' are [member_offsets[i], member_offsets[i+1])
+	std::vector<uint32_t> member_ids;
+}; // ~class RefClusters
@@ -6,57 +6,77 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 
 #include "common.hpp" // Format, FASTA_HEADER_START, FASTQ_HEADER_START
+#include "arena.hpp"
 
 // forward
 class Refstats;
 struct Runopts;
 
+/**
+ * References of a loaded index part
+ *
+ * Sequences (0-4 encoding) and headers are kept in two contiguous pools addressed by offset arrays
+ * i.e. no per-reference allocations. The pools are allocated from a huge page backed arena (OPT_HUGE_PAGES). The pools are bulk-read from the packed reference file
+ * 'IDX_PFX.refs_PART.dat' written at index build time (see 'store'). If the packed file is missing
+ * (index built by an older version) the reference FASTA/FASTQ is parsed and the packed file is written.
+ *
+ * Packed file layout:
+ *   char[8]   REFS_MAGIC
+ *   uint32_t  number of references N
+ *   uint64_t  size of the sequence pool
+ *   uint64_t  size of the header pool
+ *   uint64_t  sequence offsets [N + 1]
+ *   uint64_t  header offsets [N + 1]
+ *   char      sequence pool
+ *   char      header pool
+ */
 class References {
 public:
-	struct BaseRecord
-	{
-		size_t nid; // index into Reference file
-		std::string id; // ID from header
-		std::string header;
-		std::string sequence;
-		std::string quality; // "" (fasta) | "xxx..." (fastq)
-		Format format; // FASTA | FATSQ
-		bool isEmpty;
-		BaseRecord(): isEmpty(true) {}
-		void clear()
-		{
-			header.clear();
-			sequence.clear();
-			quality.clear();
-			isEmpty = true;
-		}
-
-		std::string getId() {
-			std::string id = header.substr(0, header.find(' '));
-			id.erase(id.begin(), std::find_if(id.begin(), id.end(), [](auto ch) {return !(ch == FASTA_HEADER_START || ch == FASTQ_HEADER_START);}));
-			return id;
-		}
-	};
-
-	std::vector<BaseRecord> buffer; // Container for references TODO: change name?
-
 	References(): num(0), part(0) {}
 	~References() {}
 
-	void load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats); // load references into the buffer given index number and index part
+	void load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats); // load references of the given index number and index part
+	void load_text(const std::string &reffile, uint64_t start_part, uint32_t numseq_part); // parse the references from the reference file
+	bool load_packed(const std::string &packfile, uint32_t numseq_part); // bulk-read the packed references. False if missing or not matching
+	void store(const std::string &packfile); // write the packed references
 	void convert_fix(std::string & seq); // convert sequence to numberical form and fix ambiguous chars
 	std::string convertChar(int idx); // convert numerical form to char string
 	int findref(std::string id);
 	void clear();
 
+	std::size_t size() const { return seq_offsets.empty() ? 0 : seq_offsets.size() - 1; }
+	std::string_view sequence(std::size_t idx) const
+	{
+		return std::string_view(seqs + seq_offsets[idx], seq_offsets[idx + 1] - seq_offsets[idx]);
+	}
+	std::string_view header(std::size_t idx) const
+	{
+		return std::string_view(headers + hdr_offsets[idx], hdr_offsets[idx + 1] - hdr_offsets[idx]);
+	}
+	std::string_view id(std::size_t idx) const // header till the first space without the leading '>' or '@'
+	{
+		auto hdr = header(idx);
+		hdr = hdr.substr(0, hdr.find(' '));
+		while (!hdr.empty() && (hdr[0] == FASTA_HEADER_START || hdr[0] == FASTQ_HEADER_START))
+			hdr.remove_prefix(1);
+		return hdr;
+	}
+	void mem_size(std::size_t &seq_bytes, std::size_t &hdr_bytes) const; // bytes held by the pools. See MemStats
+	const Arena & get_arena() const { return arena; }
+
 public:
 	uint16_t num; // number of the reference file currently loaded
 	uint16_t part; // part of the reference file currently loaded
 
 private:
-	bool load_for_search;
+	Arena arena; // storage of the pools
+	char *seqs = nullptr; // sequence pool
+	std::vector<uint64_t> seq_offsets; // sequence 'i' is [seq_offsets[i], seq_offsets[i+1])
+	char *headers = nullptr; // header pool
+	std::vector<uint64_t> hdr_offsets; // header 'i' is [hdr_offsets[i], hdr_offsets[i+1])
 }; // ~class References
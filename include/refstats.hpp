@@ -23,6 +23,8 @@ public:
 	std::vector<uint64_t> full_read;  /* corrected size of reads (for computing E-value) see Refstats::load */
 	std::vector<uint32_t> lnwin;      /* length of seed (sliding window L). Unique per DB. Const. Obtained in Main thread. Thread safe. see Refstats::load */
 	std::vector<uint32_t> partialwin; /* length of seed/2 */
+	std::vector<uint32_t> win_span; /* read nt spanned by a seed window: the mask length of a spaced seed, else lnwin */
+	std::vector<std::vector<uint32_t>> seed_offsets; /* spaced seed (OPT_SEED_MASK): positions of the seed nt in the window. Empty - contiguous */
 	std::vector<uint32_t> minimal_score; /* minimal SW score corresponing to the threshold E-value */
 	std::vector<std::pair<double, double>> gumbel; // Gumbel parameters Lambda and K. see Refstats::load
 	std::vector<uint64_t> numbvs; /* number of bitvectors at depth > 0 in [w_1] reverse or [w_2] forward */
@@ -0,0 +1,85 @@
+#pragma once
+/**
+ * FILE: seedhash.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Exact seed lookup of the small index parts.
+ *
+ * The seed search of a window walks the 2^L/2 'lookup_tbl' and one or two mini-burst tries,
+ * a handful of dependent cache misses per window even when the window occurs in the references
+ * exactly, which is the common case for the rRNA reads. For an index part of at most
+ * SEEDHASH_MAX_KMERS (L+1)-mers 'Index::load' adds an open addressing table of all the L-mers
+ * the trie search accepts with 0 errors, answering such a window with one or two probes.
+ * The limit keeps the table cache resident: 2^17 (L+1)-mers take 2^18 slots (2 MB), up to 4 MB
+ * when the reverse seeds not in the forward trie double it. The larger parts only use the tries.
+ *
+ * The table gives the very id the trie search returns (see 'SeedHash::build'):
+ *   1. the first (in the trie order) (L+1)-mer of 'trie_F[w_1]' starting with the window, if the
+ *      forward trie is searched i.e. 'lookup_tbl[w_1].count > minoccur'
+ *   2. else the first (L+1)-mer of 'trie_R[w_2]' ending with the window, if the reverse trie is searched
+ * A window not in the table has no exact match and goes through the tries for the 1-error matches.
+ * Not used with OPT_FULL_SEARCH which collects all the matches of a window.
+ *
+ * Entry: L-mer (2 bits/nt, first nt highest) << ID_BITS | (L+1)-mer id. ~0 - empty slot.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define SEEDHASH_MAX_KMERS (1U << 17) /* max (L+1)-mers of an index part using the seed hash */
+
+// forward
+struct kmer;
+struct NodeElement;
+
+class SeedHash {
+public:
+	SeedHash() {}
+
+	// build for the loaded index part. No-op (and 'is_built' false) if the part is too large
+	void build(const std::vector<kmer> &lookup_tbl, uint32_t number_elements, uint32_t partialwin, uint32_t minoccur);
+	void clear();
+	bool is_built() const { return !slots.empty(); }
+	std::size_t mem_size() const { return slots.capacity() * sizeof(uint64_t); }
+	std::size_t size() const { return num_seeds; }
+
+	/**
+	 * @param keyf  hash of the first half of the window [w_1] (Read::hashKmer)
+	 * @param keyr  hash of the second half [w_2]
+	 * @param id    OUT (L+1)-mer id i.e. index into 'positions_tbl'
+	 * @return the window has an exact match
+	 */
+	bool find(uint32_t keyf, uint32_t keyr, uint32_t &id) const
+	{
+		uint64_t key = (uint64_t(keyf) << half_bits) | keyr;
+		for (auto pos = slot(key);; pos = (pos + 1) & mask)
+		{
+			auto entry = slots[pos];
+			if (entry == EMPTY) return false;
+			if ((entry >> id_bits) == key)
+			{
+				id = static_cast<uint32_t>(entry & id_mask);
+				return true;
+			}
+		}
+	}
+
+private:
+	static const uint64_t EMPTY = ~uint64_t(0);
+
+	std::size_t slot(uint64_t key) const { return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift); }
+	bool insert(uint64_t key, uint32_t id); // false - the key is present
+	void resize(std::size_t num_slots); // power of 2
+	void collect(const NodeElement *node, uint32_t depth, uint64_t path, std::vector<std::pair<uint64_t, uint32_t>> &seeds) const;
+
+	std::vector<uint64_t> slots;
+	std::size_t mask = 0;
+	uint32_t shift = 64;
+	uint32_t half_bits = 0; // 2 * partialwin
+	uint32_t id_bits = 0; // 64 - 2 * half_bits
+	uint64_t id_mask = 0;
+	uint32_t partialwin = 0;
+	std::size_t num_seeds = 0;
+}; // ~class SeedHash
@@ -0,0 +1,53 @@
+#pragma once
+/**
+ * FILE: slowreads.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Slow-read diagnostics ('--slow_read MS').
+ *
+ * Reads whose alignment against an index part takes longer than the threshold are logged
+ * into 'WORKDIR/out/slow_reads.tsv' together with the search statistics of the read:
+ * passes, windows searched, readhit, seed hits (id_win_hits), candidate references and SW calls.
+ * Used to find the pathological reads (low complexity, hyper-conserved regions) and to tune
+ * 'max_pos', 'minoccur' and 'passes' for the data.
+ *
+ * The statistics are collected into a thread local ReadDiag, so the search code only does
+ * a pointer check when the option is off.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// forward
+struct Runopts;
+class Read;
+
+struct ReadDiag {
+	uint32_t passes = 0; // calls to compute_lis_alignment
+	uint32_t windows = 0; // read windows searched in the index
+	uint32_t masked = 0; // read windows skipped as low complexity (OPT_DUST)
+	uint32_t candidates = 0; // candidate references with enough seed hits
+	uint32_t sw_calls = 0; // Smith-Waterman alignments
+	std::size_t max_hits = 0; // max size of id_win_hits over the searched strands
+};
+
+extern thread_local ReadDiag *read_diag; // diagnostics of the read being processed. Null if '--slow_read' is off
+
+class SlowReads {
+public:
+	static void open(Runopts &opts); // called from main thread before the alignment
+	static void close(); // prints the summary
+	static bool is_on();
+
+	void start(); // start timing a read
+	void finish(Read &read, uint16_t index_num, uint32_t part); // log the read if slow
+
+	SlowReads();
+	~SlowReads();
+
+private:
+	ReadDiag diag;
+	std::chrono::steady_clock::time_point t0;
+};
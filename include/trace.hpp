@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * FILE: trace.hpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * Optional timeline recorder ('--trace FILE'). Writes Chrome trace-event JSON
+ * (loadable in chrome://tracing and ui.perfetto.dev) with per-thread spans for
+ * index build/load, reference load, thread pool barriers, read/KVDB/report batches.
+ *
+ * Spans are recorded as complete events ("ph":"X"). Worker jobs emit one span per
+ * TRACE_BATCH items, so the trace stays small even on large inputs.
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <string>
+#include <cstdint>
+
+const std::size_t TRACE_BATCH = 1000; // number of reads per batch span
+
+class Trace {
+public:
+	static void start(const std::string &file); // enables the recording
+	static bool is_on();
+	static int64_t now(); // microseconds since start
+	static void complete(const std::string &name, const char *cat, int64_t ts, const std::string &args = "");
+	static void thread_name(const std::string &name); // label the calling thread
+	static void write(); // write the collected events to the file given in 'start'
+};
+
+/* RAII span on the calling thread. No-op when tracing is off */
+class TraceSpan {
+public:
+	TraceSpan(const std::string &name, const char *cat, const std::string &args = "");
+	~TraceSpan();
+private:
+	std::string name;
+	const char *cat;
+	std::string args; // JSON object members e.g. "\"index\":0,\"part\":1"
+	int64_t ts;
+};
+
+/*
+ * counts items processed by a worker job and emits a span every TRACE_BATCH items
+ * The pool threads are reused by different jobs, so the job id is added to the span args.
+ */
+class TraceBatch {
+public:
+	TraceBatch(const char *name, const char *cat, const std::string &job);
+	~TraceBatch(); // emits the last partial batch
+	void add(std::size_t num = 1);
+private:
+	void emit();
+	const char *name;
+	const char *cat;
+	std::string job;
+	std::size_t count = 0;
+	int64_t ts = 0;
+};
@@ -116,4 +116,25 @@ void traversetrie_align(
 	uint32_t win_num /**< sliding window (seed) number on read */,
 	uint32_t partialwin, /**< */
 	Runopts & opts
-);
\ No newline at end of file
+);
+
+/*! @brief The seed search functions of an index part.
+
+	'partialwin' (seed length / 2) is a runtime value, but almost every run uses the default
+	seed length 18. The functions specialized for the seed lengths 12, 14, 16, 18, 20 have it
+	as a compile time constant: the bitvector loops get a fixed trip count and the Levenshtein
+	table indexing folds. Other lengths use the generic functions.
+	The arguments are the same as of the generic functions.
+*/
+struct SeedKernels {
+	uint32_t partialwin; /**< 0 - generic */
+	void (*init_win_f)(char*, UCHAR*, UCHAR*, int numbvs);
+	void (*init_win_r)(char*, UCHAR*, UCHAR*, int numbvs);
+	void (*traversetrie_align)(NodeElement*, uint32_t, unsigned char, UCHAR*, UCHAR*, bool&,
+		std::vector<id_win>&, uint32_t, uint32_t, Runopts&);
+};
+
+/*! @fn select_seed_kernels()
+	@brief select the seed search functions for the given 'partialwin'. Called once per index part (Index::load)
+*/
+const SeedKernels * select_seed_kernels(uint32_t partialwin);
\ No newline at end of file
@@ -13,6 +13,7 @@ import time
 import difflib
 import shutil
 import yaml
+import json
 from jinja2 import Environment, FileSystemLoader
 
 # globals
@@ -828,11 +829,209 @@ def t17(datad, ret={}, **kwarg):
     print("{} Done".format(STAMP))
 #END t17
 
+def bench_phases(lines):
+    """
+    Extract per-phase wall times from the timestamped sortmerna stdout
+
+    @param lines  list of (seconds since start, line)
+    @return dict {phase: seconds}
+    """
+    phases = {'index': 0.0, 'index_load': 0.0, 'refs_load': 0.0, 'align': 0.0, 'postproc': 0.0, 'report': 0.0}
+    re_idx_load = re.compile(r'Loading index \d+ part \d+/\d+ \.\.\. done \[([\d.]+)\]')
+    re_ref_load = re.compile(r'Loading references?\s+(?:\d+ part \d+/\d+\s+)?\.\.\. done \[([\d.]+)')
+    re_done = re.compile(r'\[(\w+):\d+\] Done (?:index|reference) \d+ Part: \d+ Time: ([\d.]+) sec')
+    is_index_done = False
+
+    for tm, line in lines:
+        # indexing (or the index check) is everything before the first index part is loaded
+        if not is_index_done and 'Loading index' in line:
+            phases['index'] = tm
+            is_index_done = True
+        mm = re_idx_load.search(line)
+        if mm:
+            phases['index_load'] += float(mm.group(1))
+        mm = re_ref_load.search(line)
+        if mm:
+            phases['refs_load'] += float(mm.group(1))
+        mm = re_done.search(line)
+        if mm:
+            if mm.group(1) == 'align':
+                phases['align'] += float(mm.group(2))
+            elif mm.group(1) == 'postProcess':
+                phases['postproc'] += float(mm.group(2))
+            elif mm.group(1) == 'generateReports':
+                phases['report'] += float(mm.group(2))
+    return phases
+#END bench_phases
+
+def bench_mem(lines):
+    """
+    Extract the per-phase memory peaks printed by sortmerna (see memstats.hpp)
+    e.g. '[report_peak:150] Memory peak [align]: lookup_tbl=2097152 ... total=123 rss=456'
+
+    @param lines  list of (seconds since start, line)
+    @return dict {phase: {item: bytes}}
+    """
+    mem = {}
+    re_peak = re.compile(r'Memory peak \[(\w+)\]:(.*)$')
+    for _, line in lines:
+        mm = re_peak.search(line)
+        if mm:
+            mem[mm.group(1)] = {kv.split('=')[0]: int(kv.split('=')[1]) for kv in mm.group(2).split()}
+    return mem
+#END bench_mem
+
+def bench_run(cmd, cwd=None):
+    """
+    Run sortmerna once and collect the resource usage of the process
+
+    Uses 'os.wait4' to get the rusage of this particular child
+    i.e. the peak RSS is not polluted by the previous runs.
+
+    @return dict {retcode, wall, rss_kb, cpu_util, lines}
+    """
+    STAMP = '[bench_run]'
+    print('{} Running: {}'.format(STAMP, ' '.join(cmd)))
+    ret = {'retcode': 0, 'wall': 0.0, 'rss_kb': 0, 'cpu_util': 0.0, 'lines': []}
+
+    start = time.time()
+    proc = subprocess.Popen(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True, bufsize=1)
+    for line in proc.stdout:
+        ret['lines'].append((time.time() - start, line))
+    _, status, rusage = os.wait4(proc.pid, 0)
+    ret['wall'] = time.time() - start
+    proc.returncode = os.waitstatus_to_exitcode(status) if hasattr(os, 'waitstatus_to_exitcode') else status >> 8
+    ret['retcode'] = proc.returncode
+
+    # ru_maxrss is KB on Linux, bytes on macOS
+    ret['rss_kb'] = rusage.ru_maxrss if not sys.platform == 'darwin' else rusage.ru_maxrss // 1024
+    if ret['wall'] > 0:
+        ret['cpu_util'] = (rusage.ru_utime + rusage.ru_stime) / ret['wall']
+
+    print('{} Run time: {:.2f} Retcode: {}'.format(STAMP, ret['wall'], ret['retcode']))
+    return ret
+#END bench_run
+
+def bench_compare(rec, base, tol):
+    """
+    Compare a benchmark record against the baseline record
+
+    @param rec   dict  current measurement
+    @param base  dict  baseline measurement of the same scenario
+    @param tol   dict  tolerances (see bench.jinja.yaml)
+    @return list of regression messages. Empty if none.
+    """
+    regs = []
+    def check(metric, cur, ref, tolv, higher_is_worse=True):
+        if not ref:
+            return
+        delta = (cur - ref) / ref if higher_is_worse else (ref - cur) / ref
+        if delta > tolv:
+            regs.append('{}: {:.2f} baseline: {:.2f} ({:+.1f}% > {:.1f}%)'.format(
+                metric, cur, ref, delta * 100, tolv * 100))
+
+    check('wall', rec['wall'], base.get('wall'), tol.get('wall', 0.1))
+    check('rss_kb', rec['rss_kb'], base.get('rss_kb'), tol.get('rss_kb', 0.1))
+    check('reads_sec', rec['reads_sec'], base.get('reads_sec'), tol.get('reads_sec', 0.1), higher_is_worse=False)
+    check('cpu_util', rec['cpu_util'], base.get('cpu_util'), tol.get('cpu_util', 0.2), higher_is_worse=False)
+    for phase, val in rec['phases'].items():
+        ref = base.get('phases', {}).get(phase, 0.0)
+        if ref >= tol.get('min_phase_sec', 0.5):
+            check('phase:{}'.format(phase), val, ref, tol.get('phases', 0.15))
+    return regs
+#END bench_compare
+
+def bench(cfg, names, history, baseline, is_update_baseline=False):
+    """
+    End-to-end benchmark of the scenarios in bench.jinja.yaml
+
+    Every run is appended as a JSON line to the history file.
+    Regressions against the baseline are printed and reflected in the return code.
+
+    @param cfg       rendered bench.jinja.yaml
+    @param names     list of scenario names to run
+    @param history   path to history file (JSON lines)
+    @param baseline  path to baseline file (JSON)
+    @param is_update_baseline  store the results of this run as the new baseline
+    @return number of regressed scenarios
+    """
+    STAMP = '[bench]'
+    base = {}
+    if os.path.exists(baseline):
+        with open(baseline) as bfh:
+            base = json.load(bfh)
+    else:
+        print('{} No baseline found at {}. Comparison skipped'.format(STAMP, baseline))
+
+    tol = cfg.get('tolerance', {})
+    num_regressed = 0
+    results = {}
+
+    for name in names:
+        scn = cfg['scenarios'][name]
+        print('{} Running {}: {}'.format(STAMP, name, scn['name']))
+        process_smr_opts(scn['cmd'])
+        # alignment results are always recomputed
+        if os.path.exists(KVDB_DIR):
+            shutil.rmtree(KVDB_DIR)
+        ali_dir = os.path.dirname(ALIF)
+        if ali_dir and os.path.exists(ali_dir):
+            shutil.rmtree(ali_dir)
+
+        ret = bench_run([SMR_EXE] + scn['cmd'], cwd=scn.get('cwd'))
+        if ret['retcode']:
+            print('{} ERROR: {} failed with code {}'.format(STAMP, name, ret['retcode']))
+            print(''.join(ln for _, ln in ret['lines'][-20:]))
+            num_regressed += 1
+            continue
+
+        num_reads = parse_log(LOGF)['num_reads'][1] if os.path.exists(LOGF) else 0
+        rec = {
+            'name': name,
+            'date': time.strftime('%Y-%m-%d %H:%M:%S'),
+            'host': platform.node(),
+            'wall': round(ret['wall'], 3),
+            'phases': {k: round(v, 3) for k, v in bench_phases(ret['lines']).items()},
+            'num_reads': num_reads,
+            'reads_sec': round(num_reads / ret['wall'], 1) if ret['wall'] > 0 else 0,
+            'rss_kb': ret['rss_kb'],
+            'cpu_util': round(ret['cpu_util'], 2),
+            'mem_peak': bench_mem(ret['lines'])
+        }
+        results[name] = rec
+        with open(history, 'a') as hfh:
+            hfh.write(json.dumps(rec) + '\n')
+
+        print('{} {}: wall= {} reads/s= {} rss_kb= {} cpu= {}'.format(
+            STAMP, name, rec['wall'], rec['reads_sec'], rec['rss_kb'], rec['cpu_util']))
+        print('{} {}: phases= {}'.format(STAMP, name, rec['phases']))
+
+        if base.get(name):
+            regs = bench_compare(rec, base[name], tol)
+            if regs:
+                num_regressed += 1
+                for reg in regs:
+                    print('{} REGRESSION {}: {}'.format(STAMP, name, reg))
+            else:
+                print('{} {}: OK'.format(STAMP, name))
+
+    if is_update_baseline:
+        base.update(results)
+        with open(baseline, 'w') as bfh:
+            json.dump(base, bfh, indent=2)
+        print('{} Baseline updated: {}'.format(STAMP, baseline))
+
+    print('{} Done. Scenarios regressed: {}'.format(STAMP, num_regressed))
+    return num_regressed
+#END bench
+
 if __name__ == "__main__":
     '''
     python scripts/run.py --name t0 [--capture] [--env scripts/env_non_git.yaml] [--validate-only]
     python scripts/run.py --name t16 --env /home/xx/env.yaml
     python /mnt/c/Users/XX/sortmerna/tests/run.py --name t0 --winhome /mnt/c/Users/XX [--capture]
+    python scripts/run.py --bench [--name b1] [--baseline bench_baseline.json] [--update-baseline]
     '''
     import pdb; pdb.set_trace()
 
@@ -848,6 +1047,10 @@ if __name__ == "__main__":
     optpar.add_option('--ddir', dest='ddir', help = 'Data directory')
     optpar.add_option('--config', dest='config', help='Tests configuration file.')
     optpar.add_option('--env', dest='envfile', help='Environment variables')
+    optpar.add_option('--bench', action="store_true", help='Run benchmark scenarios (bench.jinja.yaml). All if no \'--name\'')
+    optpar.add_option('--history', dest='history', help='Benchmark history file (JSON lines). Default: BENCH_DIR/bench_history.jsonl')
+    optpar.add_option('--baseline', dest='baseline', help='Benchmark baseline file (JSON). Default: BENCH_DIR/bench_baseline.json')
+    optpar.add_option('--update-baseline', action="store_true", help='Store the benchmark results as the new baseline')
 
     (opts, args) = optpar.parse_args()
 
@@ -867,7 +1070,8 @@ if __name__ == "__main__":
             env = yaml.load(envh, Loader=yaml.FullLoader)
 
     # check jinja.yaml
-    cfgfile = os.path.join(cur_dir, 'test.jinja.yaml') if not opts.config else opts.config
+    cfg_default = 'bench.jinja.yaml' if opts.bench else 'test.jinja.yaml'
+    cfgfile = os.path.join(cur_dir, cfg_default) if not opts.config else opts.config
     if not os.path.exists(cfgfile):
         print('No build configuration template found. Please, provide one using \'--config\' option')
         sys.exit(1)
@@ -883,7 +1087,8 @@ if __name__ == "__main__":
     if not os.path.exists(SMR_SRC):
         print('Sortmerna source directory {} not found. Either specify location in env.yaml or make sure the sources exist at {}'.format(SMR_SRC, SMR_SRC))
     DATA_DIR = env[OS]['DATA_DIR']
-    cfg_str = template.render({'SMR_SRC':SMR_SRC, 'DATA_DIR':DATA_DIR})
+    BENCH_DIR = os.path.join(UHOME, 'sortmerna', 'bench')
+    cfg_str = template.render({'SMR_SRC':SMR_SRC, 'DATA_DIR':DATA_DIR, 'BENCH_DIR':BENCH_DIR})
     #cfg_str = template.render(env) # env[OS]
     cfg = yaml.load(cfg_str, Loader=yaml.FullLoader)
     
@@ -892,6 +1097,17 @@ if __name__ == "__main__":
     SMR_EXE  = os.path.join(SMR_DIST, 'bin', 'sortmerna')
     TEST_DATA = os.path.join(SMR_SRC, 'data')
 
+    # benchmark mode
+    if opts.bench:
+        if opts.clean and os.path.exists(BENCH_DIR):
+            print('Removing Bench dir: {}'.format(BENCH_DIR))
+            shutil.rmtree(BENCH_DIR)
+        os.makedirs(BENCH_DIR, exist_ok=True)
+        names = [opts.name] if opts.name else list(cfg['scenarios'].keys())
+        history = opts.history if opts.history else os.path.join(BENCH_DIR, 'bench_history.jsonl')
+        baseline = opts.baseline if opts.baseline else os.path.join(BENCH_DIR, 'bench_baseline.json')
+        sys.exit(1 if bench(cfg, names, history, baseline, opts.update_baseline) else 0)
+
     process_smr_opts(cfg[opts.name]['cmd'])
 
     # clean-up the KVDB, IDX directories, and the output. 
@@ -950,4 +1166,4 @@ if __name__ == "__main__":
     #        funcs[fn](nm, TEST_DATA, OUT_DIR, ret, **cfg[opts.name]['validate'])
     # other funcs
     #elif opts.name == 'to_lf':
-    #    to_lf(DATA_DIR)
\ No newline at end of file
+    #    to_lf(DATA_DIR)
\ No newline at end of file
@@ -0,0 +1,613 @@
+/**
+ * FILE: aio.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING
+#endif
+#endif
+
+#include "common.hpp"
+#include "aio.hpp"
+
+namespace {
+	enum IoMode { IO_STREAM, IO_PREAD, IO_URING };
+	IoMode io_mode = IO_STREAM; // set once by 'Aio::set_mode' before the threads start. Read only after
+
+	// whole request: pread/pwrite until all the bytes are transferred or the end of the file
+	long transfer(bool is_write, int fd, char *buf, std::size_t len, uint64_t off)
+	{
+		std::size_t done = 0;
+		while (done < len)
+		{
+			auto num = is_write ? ::pwrite(fd, buf + done, len - done, static_cast<off_t>(off + done))
+				: ::pread(fd, buf + done, len - done, static_cast<off_t>(off + done));
+			if (num < 0)
+			{
+				if (errno == EINTR) continue;
+				return -errno;
+			}
+			if (num == 0) break; // end of the file
+			done += static_cast<std::size_t>(num);
+		}
+		return static_cast<long>(done);
+	}
+}
+
+/*
+ * positional reads/writes of a single file, a request per slot
+ */
+class AioQueue {
+public:
+	virtual ~AioQueue() {}
+	virtual void submit(unsigned slot, bool is_write, int fd, char *buf, std::size_t len, uint64_t off) = 0;
+	virtual long wait(unsigned slot) = 0; // bytes transferred or -errno
+
+	static std::unique_ptr<AioQueue> make(unsigned depth);
+};
+
+/*
+ * 'depth' worker threads started with the queue, each transfers the next submitted request
+ */
+class PreadQueue : public AioQueue {
+public:
+	PreadQueue(unsigned depth) : requests(depth)
+	{
+		workers.reserve(depth);
+		for (unsigned i = 0; i < depth; ++i)
+			workers.emplace_back(&PreadQueue::run, this);
+	}
+	~PreadQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_lock);
+			is_shutdown = true; // the workers finish the queued requests first
+		}
+		cvQueue.notify_all();
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+	void submit(unsigned slot, bool is_write, int fd, char *buf, std::size_t len, uint64_t off) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_lock);
+			requests[slot] = { is_write, fd, buf, len, off, false, 0 };
+			queue.push_back(slot);
+		}
+		cvQueue.notify_one();
+	}
+
+	long wait(unsigned slot) override
+	{
+		std::unique_lock<std::mutex> lock(queue_lock);
+		cvDone.wait(lock, [&] { return requests[slot].is_done; });
+		return requests[slot].result;
+	}
+
+private:
+	struct Request {
+		bool is_write;
+		int fd;
+		char *buf;
+		std::size_t len;
+		uint64_t off;
+		bool is_done;
+		long result;
+	};
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(queue_lock);
+		for (;;)
+		{
+			cvQueue.wait(lock, [this] { return is_shutdown || !queue.empty(); });
+			if (queue.empty())
+				return; // shutdown
+			auto slot = queue.front();
+			queue.pop_front();
+			auto req = requests[slot];
+			lock.unlock();
+			auto result = transfer(req.is_write, req.fd, req.buf, req.len, req.off);
+			lock.lock();
+			requests[slot].result = result;
+			requests[slot].is_done = true;
+			cvDone.notify_all(); // the waiter of this slot
+		}
+	} // ~PreadQueue::run
+
+	std::vector<Request> requests;
+	std::deque<unsigned> queue; // submitted slots not yet taken by a worker
+	std::vector<std::thread> workers;
+	std::mutex queue_lock; // 'requests', 'queue', 'is_shutdown'
+	std::condition_variable cvQueue;
+	std::condition_variable cvDone;
+	bool is_shutdown = false;
+}; // ~class PreadQueue
+
+#ifdef HAVE_IO_URING
+/*
+ * minimal io_uring on the raw system calls: a ring of 'depth' entries, a request per slot
+ */
+class UringQueue : public AioQueue {
+public:
+	UringQueue(unsigned depth) : requests(depth) {}
+	~UringQueue()
+	{
+		for (unsigned i = 0; i < requests.size(); ++i)
+			if (requests[i].is_pending) wait(i);
+		if (sqes) munmap(sqes, sqes_len);
+		if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+		if (sq_ptr) munmap(sq_ptr, sq_len);
+		if (ring_fd >= 0) ::close(ring_fd);
+	}
+
+	bool init()
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(requests.size()), &params));
+		if (ring_fd < 0)
+			return false;
+
+		sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool is_single = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (is_single)
+			sq_len = cq_len = std::max(sq_len, cq_len);
+		sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+		if (sq_ptr == MAP_FAILED) { sq_ptr = nullptr; return false; }
+		cq_ptr = is_single ? sq_ptr : mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED) { cq_ptr = nullptr; return false; }
+		sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+		void *ptr = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+		if (ptr == MAP_FAILED) return false;
+		sqes = static_cast<io_uring_sqe*>(ptr);
+
+		auto *sq = static_cast<char*>(sq_ptr);
+		auto *cq = static_cast<char*>(cq_ptr);
+		sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		return true;
+	}
+
+	void submit(unsigned slot, bool is_write, int fd, char *buf, std::size_t len, uint64_t off) override
+	{
+		auto &req = requests[slot];
+		req = { is_write, fd, buf, len, off, true, false, 0, { buf, len } };
+
+		unsigned tail = *sq_tail; // the only producer
+		unsigned idx = tail & sq_mask;
+		io_uring_sqe *sqe = &sqes[idx];
+		std::memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV; // since 5.1
+		sqe->fd = fd;
+		sqe->addr = reinterpret_cast<uint64_t>(&req.iov);
+		sqe->len = 1;
+		sqe->off = off;
+		sqe->user_data = slot;
+		sq_array[idx] = idx;
+		__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+		if (syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0) < 0)
+		{
+			req.result = transfer(is_write, fd, buf, len, off); // not submitted - do it here
+			req.is_done = true;
+			__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+		}
+	}
+
+	long wait(unsigned slot) override
+	{
+		auto &req = requests[slot];
+		while (!req.is_done)
+		{
+			unsigned head = *cq_head;
+			if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+			{
+				if (syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+				{
+					req.is_pending = false; // the ring is unusable: fail the request instead of spinning
+					return -errno;
+				}
+				continue;
+			}
+			const io_uring_cqe &cqe = cqes[head & cq_mask];
+			auto &done = requests[cqe.user_data];
+			done.result = cqe.res;
+			done.is_done = true;
+			__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+		}
+		req.is_pending = false;
+		// a short transfer is completed synchronously
+		if (req.result >= 0 && static_cast<std::size_t>(req.result) < req.len)
+		{
+			auto rest = transfer(req.is_write, req.fd, req.buf + req.result, req.len - req.result, req.off + req.result);
+			req.result = rest < 0 ? rest : req.result + rest;
+		}
+		return req.result;
+	}
+
+private:
+	struct Request {
+		bool is_write;
+		int fd;
+		char *buf;
+		std::size_t len;
+		uint64_t off;
+		bool is_pending;
+		bool is_done;
+		long result;
+		iovec iov;
+	};
+	std::vector<Request> requests;
+	int ring_fd = -1;
+	void *sq_ptr = nullptr;
+	void *cq_ptr = nullptr;
+	std::size_t sq_len = 0;
+	std::size_t cq_len = 0;
+	std::size_t sqes_len = 0;
+	io_uring_sqe *sqes = nullptr;
+	unsigned *sq_tail = nullptr;
+	unsigned sq_mask = 0;
+	unsigned *sq_array = nullptr;
+	unsigned *cq_head = nullptr;
+	unsigned *cq_tail = nullptr;
+	unsigned cq_mask = 0;
+	io_uring_cqe *cqes = nullptr;
+}; // ~class UringQueue
+#endif // HAVE_IO_URING
+
+std::unique_ptr<AioQueue> AioQueue::make(unsigned depth)
+{
+#ifdef HAVE_IO_URING
+	if (io_mode == IO_URING)
+	{
+		std::unique_ptr<UringQueue> queue(new UringQueue(depth));
+		if (queue->init())
+			return queue;
+	}
+#endif
+	// io_uring is available (see 'Aio::set_mode') but this ring could not be set up e.g. the locked memory limit
+	return std::unique_ptr<AioQueue>(new PreadQueue(depth));
+} // ~AioQueue::make
+
+void Aio::set_mode(const std::string &mode)
+{
+	io_mode = mode == "uring" ? IO_URING : mode == "pread" ? IO_PREAD : IO_STREAM;
+
+	// the fallback is decided here, before any file is opened, by setting up a probe ring
+	if (io_mode == IO_URING)
+	{
+		bool is_uring = false;
+#ifdef HAVE_IO_URING
+		is_uring = UringQueue(1).init();
+#endif
+		if (!is_uring)
+		{
+			WARN("io_uring is not available. Using 'pread'");
+			io_mode = IO_PREAD;
+		}
+	}
+}
+
+bool Aio::is_stream() { return io_mode == IO_STREAM; }
+
+// AioInBuf
+
+AioInBuf::AioInBuf() {}
+AioInBuf::~AioInBuf() { close(); }
+
+bool AioInBuf::open(const std::string &path)
+{
+	close();
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close();
+		return false;
+	}
+	file_size = static_cast<uint64_t>(st.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	queue = AioQueue::make(AIO_DEPTH);
+	slots.resize(AIO_DEPTH);
+	for (auto &slot : slots)
+		slot.data.resize(AIO_CHUNK);
+	seekpos(0, std::ios_base::in);
+	return true;
+} // ~AioInBuf::open
+
+void AioInBuf::close()
+{
+	if (fd < 0)
+		return;
+	drain();
+	queue.reset();
+	slots.clear();
+	::close(fd);
+	fd = -1;
+	setg(nullptr, nullptr, nullptr);
+}
+
+void AioInBuf::submit(unsigned idx)
+{
+	auto &slot = slots[idx];
+	slot.is_pending = next_off < file_size;
+	if (!slot.is_pending)
+		return;
+	slot.off = next_off;
+	slot.len = static_cast<std::size_t>(std::min<uint64_t>(AIO_CHUNK, file_size - next_off));
+	next_off += slot.len;
+	queue->submit(idx, false, fd, slot.data.data(), slot.len, slot.off);
+}
+
+void AioInBuf::drain()
+{
+	for (unsigned i = 0; i < slots.size(); ++i)
+	{
+		if (slots[i].is_pending)
+		{
+			queue->wait(i);
+			slots[i].is_pending = false;
+		}
+	}
+}
+
+AioInBuf::int_type AioInBuf::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+	if (fd < 0)
+		return traits_type::eof();
+
+	if (is_cur)
+	{
+		// the consumed slot reads ahead
+		is_cur = false;
+		submit(cur);
+		cur = (cur + 1) % slots.size();
+	}
+	auto &slot = slots[cur];
+	if (!slot.is_pending)
+		return traits_type::eof(); // end of the file
+
+	auto num = queue->wait(cur);
+	slot.is_pending = false;
+	if (num != static_cast<long>(slot.len))
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed reading " << slot.len << " bytes at offset " << slot.off << ": "
+			<< (num < 0 ? std::strerror(static_cast<int>(-num)) : "short read");
+		ERR(ss.str());
+		return traits_type::eof();
+	}
+	is_cur = true;
+	setg(slot.data.data(), slot.data.data(), slot.data.data() + slot.len);
+	return traits_type::to_int_type(*gptr());
+} // ~AioInBuf::underflow
+
+uint64_t AioInBuf::tell() const
+{
+	if (is_cur)
+		return slots[cur].off + static_cast<uint64_t>(gptr() - eback());
+	return slots[cur].is_pending ? slots[cur].off : next_off;
+}
+
+AioInBuf::pos_type AioInBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if (fd < 0 || !(which & std::ios_base::in))
+		return pos_type(off_type(-1));
+	off_type base = dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? static_cast<off_type>(tell()) : static_cast<off_type>(file_size);
+	if (dir == std::ios_base::cur && off == 0)
+		return pos_type(base); // tellg
+	return seekpos(pos_type(base + off), which);
+}
+
+AioInBuf::pos_type AioInBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	if (fd < 0 || !(which & std::ios_base::in) || off_type(pos) < 0)
+		return pos_type(off_type(-1));
+	drain();
+	next_off = std::min<uint64_t>(static_cast<uint64_t>(off_type(pos)), file_size);
+	cur = 0;
+	is_cur = false;
+	setg(nullptr, nullptr, nullptr);
+	for (unsigned i = 0; i < slots.size(); ++i)
+		submit(i);
+	return pos;
+} // ~AioInBuf::seekpos
+
+// AioOutBuf
+
+AioOutBuf::AioOutBuf() {}
+AioOutBuf::~AioOutBuf() { close(); }
+
+bool AioOutBuf::open(const std::string &path, bool is_append)
+{
+	close();
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (is_append ? 0 : O_TRUNC), 0644);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	next_off = is_append && fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+	is_error = false;
+	queue = AioQueue::make(AIO_DEPTH);
+	slots.resize(AIO_DEPTH);
+	for (auto &slot : slots)
+		slot.data.resize(AIO_CHUNK);
+	cur = 0;
+	setp(slots[cur].data.data(), slots[cur].data.data() + AIO_CHUNK);
+	return true;
+} // ~AioOutBuf::open
+
+bool AioOutBuf::close()
+{
+	if (fd < 0)
+		return !is_error;
+	submit();
+	for (unsigned i = 0; i < slots.size(); ++i)
+		wait(i);
+	queue.reset();
+	slots.clear();
+	setp(nullptr, nullptr);
+	if (::close(fd) != 0)
+		is_error = true;
+	fd = -1;
+	return !is_error;
+} // ~AioOutBuf::close
+
+bool AioOutBuf::wait(unsigned idx)
+{
+	auto &slot = slots[idx];
+	if (!slot.is_pending)
+		return true;
+	auto num = queue->wait(idx);
+	slot.is_pending = false;
+	if (num != static_cast<long>(slot.len))
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed writing " << slot.len << " bytes: " << (num < 0 ? std::strerror(static_cast<int>(-num)) : "short write");
+		ERR(ss.str());
+		is_error = true;
+	}
+	return !is_error;
+}
+
+bool AioOutBuf::submit()
+{
+	auto &slot = slots[cur];
+	slot.len = static_cast<std::size_t>(pptr() - pbase());
+	if (slot.len > 0)
+	{
+		slot.is_pending = true;
+		queue->submit(cur, true, fd, slot.data.data(), slot.len, next_off);
+		next_off += slot.len;
+		cur = (cur + 1) % slots.size();
+		wait(cur); // the next slot is free once its previous chunk is written
+	}
+	setp(slots[cur].data.data(), slots[cur].data.data() + AIO_CHUNK);
+	return !is_error;
+} // ~AioOutBuf::submit
+
+AioOutBuf::int_type AioOutBuf::overflow(int_type ch)
+{
+	if (fd < 0 || !submit())
+		return traits_type::eof();
+	if (!traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		*pptr() = traits_type::to_char_type(ch);
+		pbump(1);
+	}
+	return traits_type::not_eof(ch);
+}
+
+int AioOutBuf::sync() { return is_error ? -1 : 0; }
+
+// AioIfstream
+
+void AioIfstream::open(const std::string &path, std::ios_base::openmode mode)
+{
+	bool is_ok = false;
+	is_aio = !Aio::is_stream();
+	if (is_aio)
+	{
+		auto *aiobuf = new AioInBuf();
+		buf.reset(aiobuf);
+		is_ok = aiobuf->open(path);
+	}
+	else
+	{
+		auto *filebuf = new std::filebuf();
+		buf.reset(filebuf);
+		is_ok = filebuf->open(path, mode | std::ios_base::in) != nullptr;
+	}
+	rdbuf(buf.get()); // clears the state
+	if (!is_ok)
+		setstate(std::ios_base::failbit);
+} // ~AioIfstream::open
+
+bool AioIfstream::is_open() const
+{
+	if (!buf) return false;
+	return is_aio ? static_cast<AioInBuf*>(buf.get())->is_open() : static_cast<std::filebuf*>(buf.get())->is_open();
+}
+
+void AioIfstream::close()
+{
+	if (!is_open())
+		return;
+	if (is_aio)
+		static_cast<AioInBuf*>(buf.get())->close();
+	else if (!static_cast<std::filebuf*>(buf.get())->close())
+		setstate(std::ios_base::failbit);
+}
+
+// AioOfstream
+
+void AioOfstream::open(const std::string &path, std::ios_base::openmode mode)
+{
+	bool is_ok = false;
+	is_aio = !Aio::is_stream();
+	if (is_aio)
+	{
+		auto *aiobuf = new AioOutBuf();
+		buf.reset(aiobuf);
+		is_ok = aiobuf->open(path, (mode & std::ios_base::app) != 0);
+	}
+	else
+	{
+		auto *filebuf = new std::filebuf();
+		buf.reset(filebuf);
+		is_ok = filebuf->open(path, mode | std::ios_base::out) != nullptr;
+	}
+	rdbuf(buf.get()); // clears the state
+	if (!is_ok)
+		setstate(std::ios_base::failbit);
+} // ~AioOfstream::open
+
+bool AioOfstream::is_open() const
+{
+	if (!buf) return false;
+	return is_aio ? static_cast<AioOutBuf*>(buf.get())->is_open() : static_cast<std::filebuf*>(buf.get())->is_open();
+}
+
+void AioOfstream::close()
+{
+	if (!is_open())
+		return;
+	bool is_ok = is_aio ? static_cast<AioOutBuf*>(buf.get())->close() : static_cast<std::filebuf*>(buf.get())->close() != nullptr;
+	if (!is_ok)
+		setstate(std::ios_base::failbit);
+}
+
+// ~aio.cpp
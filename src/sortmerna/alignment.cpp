@@ -33,6 +33,8 @@
 
 #include <sstream>
 #include <fstream>
+#include <bitset>
+#include <emmintrin.h>
 
 #include "alignment.hpp"
 #include "read.hpp"
@@ -40,28 +42,48 @@
 #include "refstats.hpp"
 #include "references.hpp"
 #include "readstats.hpp"
+#include "perfcounters.hpp"
+#include "slowreads.hpp"
 
 #define ASCENDING <
 #define DESCENDING >
 
 
 // forward
+std::size_t AlignScratch::mem_size() const
+{
+	return read_pos_searched.capacity() / 8 + bitvec.capacity() + (id_hits.capacity() + win_hits.capacity()) * sizeof(id_win)
+		+ (kmer_count.capacity() + kmer_refs.capacity() + lis_arr.capacity() + lis_p.capacity()) * sizeof(uint32_t)
+		+ win_ee.capacity() * sizeof(float)
+		+ (kmer_count_vec.capacity() + hits_per_ref.capacity() + match_chain.buf.capacity()) * sizeof(uint32pair);
+}
+
+bool ReadBudget::check(const Runopts & opts)
+{
+	if (is_over) return true;
+	is_over = (opts.max_candidates > 0 && candidates >= opts.max_candidates)
+		|| (opts.max_sw_cells > 0 && sw_cells >= opts.max_sw_cells)
+		|| (opts.max_read_time > 0 && std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count() >= opts.max_read_time);
+	return is_over;
+} // ~ReadBudget::check
+
 s_align2 copyAlignment(s_align* pAlign);
 uint32_t findMinIndex(Read & read);
 
 /*
  * see alignment.hpp for documentation
  */
-void find_lis( deque<pair<uint32_t, uint32_t>> &a, vector<uint32_t> &b )
+void find_lis(const uint32pair *a, std::size_t n, vector<uint32_t> &b, vector<uint32_t> &p)
 {
-	vector<uint32_t> p(a.size());
 	std::size_t u, v;
 
-	if (a.empty()) return;
+	if (n == 0) return;
 
+	p.assign(n, 0);
 	b.push_back(0);
 
-	for (std::size_t i = 1; i < a.size(); i++)
+	for (std::size_t i = 1; i < n; i++)
 	{
 		// If next element a[i] is greater than last element of current longest subsequence a[b.back()], just push it at back of "b" and continue
 		if (a[b.back()].second < a[i].second)
@@ -94,12 +116,419 @@ void find_lis( deque<pair<uint32_t, uint32_t>> &a, vector<uint32_t> &b )
 		b[u] = static_cast<uint32_t>(v);
 } // ~find_lis
 
+/*
+ * Smith-Waterman precision planner: the 'score_size' of 'ssw_init'. The striped 8-bit kernel saturates
+ * at 255 (the matrix bias included) and 'ssw_align' then reruns the whole alignment with the 16-bit kernel.
+ *   0 - 8-bit only: the score cannot saturate, the 16-bit profile is not built
+ *   1 - 16-bit only: the predicted score saturates, the 8-bit run would be thrown away
+ *   2 - 8-bit, 16-bit on saturation
+ *
+ * @param query_len  length of the read part aligned
+ * @param predicted  score predicted by the seeds (see 'seed_score') or by an alignment already made
+ */
+static int8_t plan_score_size(const Read & read, uint32_t query_len, int64_t predicted)
+{
+	auto minmax = std::minmax_element(read.scoring_matrix.begin(), read.scoring_matrix.end());
+	int64_t bias = std::max<int64_t>(0, -*minmax.first);
+	if (*minmax.second * static_cast<int64_t>(query_len) + bias < 255)
+		return 0;
+	if (predicted + bias >= 255)
+		return 1;
+	return 2;
+} // ~plan_score_size
+
+/*
+ * score predicted by the LIS seeds: the read nt covered by the seeds match, each seed has an error
+ */
+static int64_t seed_score(const Read & read, ScratchQueue<uint32pair> & match_chain, const vector<uint32_t> & lis_arr, uint32_t seed_len)
+{
+	auto minmax = std::minmax_element(read.scoring_matrix.begin(), read.scoring_matrix.end());
+	int64_t covered = 0;
+	uint32_t covered_end = 0;
+	for (auto idx : lis_arr) // ascending read positions
+	{
+		uint32_t seed_end = match_chain[idx].second + seed_len;
+		if (seed_end > covered_end)
+			covered += seed_end - std::max(match_chain[idx].second, covered_end);
+		covered_end = std::max(covered_end, seed_end);
+	}
+	return *minmax.second * covered - static_cast<int64_t>(*minmax.second - *minmax.first) * lis_arr.size();
+} // ~seed_score
+
+// counts of the planned precisions. See Readstats
+static void count_score_size(const Read & read, Readstats & readstats, int8_t score_size, const s_align * result)
+{
+	if (score_size == 0)
+	{
+		++readstats.sw_8bit;
+		return;
+	}
+	if (result == 0)
+		return;
+	int32_t bias = std::max<int32_t>(0, -*std::min_element(read.scoring_matrix.begin(), read.scoring_matrix.end()));
+	bool is_saturated = result->score1 + bias >= 255;
+	if (score_size == 1)
+	{
+		++readstats.sw_16bit;
+		if (is_saturated) ++readstats.sw_reruns_avoided;
+	}
+	else if (is_saturated)
+		++readstats.sw_reruns;
+} // ~count_score_size
+
+// mismatching nt of the two sequences, 16 at a time. Stops counting above 'max_mismatches'
+static uint32_t count_mismatches(const char * a, const char * b, uint32_t len, uint32_t max_mismatches)
+{
+	uint32_t mismatches = 0;
+	uint32_t i = 0;
+	for (; i + 16 <= len && mismatches <= max_mismatches; i += 16)
+	{
+		__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+		mismatches += 16 - static_cast<uint32_t>(std::bitset<16>(_mm_movemask_epi8(eq)).count());
+	}
+	for (; i < len && mismatches <= max_mismatches; ++i)
+		mismatches += a[i] != b[i];
+	return mismatches;
+} // ~count_mismatches
+
+/*
+ * ungapped alignment of a near exact read on its diagonal, without Smith-Waterman. See alignment.hpp
+ */
+s_align* near_exact_align(const char * query, const char * ref, uint32_t len, const int8_t * matrix, long gap_open, int64_t ref_offset)
+{
+	if (count_mismatches(query, ref, len, NEAR_EXACT_MAX_MISMATCHES) > NEAR_EXACT_MAX_MISMATCHES)
+		return 0;
+
+	// best scoring segment
+	int32_t score = 0;
+	int32_t best_score = 0;
+	int32_t min_score = 0; // of a column
+	int32_t max_score = 0; // of the matrix i.e. a match
+	uint32_t begin = 0;
+	uint32_t best_begin = 0;
+	uint32_t best_end = 0;
+	for (uint32_t i = 0; i < 25; ++i)
+		max_score = std::max<int32_t>(max_score, matrix[i]);
+	for (uint32_t i = 0; i < len; ++i)
+	{
+		if (score <= 0)
+		{
+			score = 0;
+			begin = i;
+		}
+		int32_t col_score = matrix[query[i] * 5 + ref[i]];
+		min_score = std::min(min_score, col_score);
+		score += col_score;
+		if (score > best_score)
+		{
+			best_score = score;
+			best_begin = begin;
+			best_end = i;
+		}
+	}
+
+	// a gapped alignment scores at most 'max_score * len - gap_open', the diagonal at least 'max_score * (len - 1) + min_score'
+	if (best_score == 0 || (min_score < 0 && gap_open < max_score - min_score))
+		return 0;
+
+	s_align* result = (s_align*)calloc(1, sizeof(s_align));
+	result->score1 = static_cast<uint16_t>(best_score);
+	result->ref_begin1 = static_cast<int32_t>(ref_offset + best_begin);
+	result->ref_end1 = static_cast<int32_t>(ref_offset + best_end);
+	result->read_begin1 = best_begin;
+	result->read_end1 = best_end;
+	result->cigar = (uint32_t*)malloc(sizeof(uint32_t));
+	result->cigar[0] = (best_end - best_begin + 1) << 4; // 'M'
+	result->cigarLen = 1;
+	return result;
+} // ~near_exact_align
+
+/*
+ * near exact fast path: the LIS seeds are on a single diagonal and the read lies within the reference on it
+ *
+ * @param ref_base  reference position the result positions are relative to, as the SW ones
+ * @return 0 - not near exact, use Smith-Waterman. Read in 04 encoding
+ */
+static s_align* near_exact_alignment(const Read & read, Runopts & opts, std::string_view ref, ScratchQueue<uint32pair> & match_chain, const vector<uint32_t> & lis_arr, std::size_t ref_base)
+{
+	int64_t diag = static_cast<int64_t>(match_chain[lis_arr[0]].first) - match_chain[lis_arr[0]].second;
+	for (auto idx : lis_arr)
+	{
+		if (static_cast<int64_t>(match_chain[idx].first) - match_chain[idx].second != diag)
+			return 0;
+	}
+
+	uint32_t readlen = static_cast<uint32_t>(read.isequence.size());
+	if (diag < static_cast<int64_t>(ref_base) || diag + readlen > static_cast<int64_t>(ref.size()))
+		return 0;
+
+	return near_exact_align(read.isequence.data(), ref.data() + diag, readlen, read.scoring_matrix.data(), opts.gap_open,
+		diag - static_cast<int64_t>(ref_base));
+} // ~near_exact_alignment
+
+/*
+ * keep the alignment of the read: store (--best) or output (--num_alignments) it.
+ * The centroid alignments and the cluster member alignments (OPT_CLUSTER_ID) alike
+ */
+static void store_alignment(Read & read, Runopts & opts, Index & index, References & refs, Readstats & readstats,
+	s_align* result, uint32_t max_SW_score, bool & read_to_count)
+{
+	// read has not been yet mapped, set bit to true for this read
+	// (this is the Only place where read_hits can be modified)
+	if (!read.is_hit)
+	{
+		read.is_hit = true;
+		++readstats.total_reads_aligned;
+		++readstats.reads_matched_per_db[index.index_num];
+	}
+
+	// update best alignment
+	if (opts.min_lis > -1)
+	{
+		// an alignment for this read already exists
+		if (read.hits_align_info.alignv.size() > 0)
+		{
+			uint32_t smallest_score_index = read.hits_align_info.min_index;
+			uint32_t highest_score_index = read.hits_align_info.max_index;
+			uint32_t hits_size = read.hits_align_info.alignv.size();
+
+			// number of alignments stored per read < 'num_best_hits', 
+			// add alignment to array without comparison to other members of array
+			if (opts.num_best_hits == 0 || hits_size < (uint32_t)opts.num_best_hits)
+			{
+				auto rescopy = copyAlignment(result);
+				if (rescopy == read.hits_align_info.alignv.back())
+					; // skip equivalent alignment
+				else if (rescopy.score1 > read.hits_align_info.alignv.back().score1)
+				{
+					if (rescopy.ref_seq == read.hits_align_info.alignv.back().ref_seq)
+					{
+						read.hits_align_info.alignv.back() = rescopy; // replace alignment
+					}
+					else
+					{
+						// add alignment
+						read.hits_align_info.alignv.push_back(rescopy);
+						++hits_size;
+
+						// read alignments are filled to max size, find the smallest
+						// alignment score and set the smallest_score_index
+						// (this is not done when num_best_hits_gv == 0 since
+						// we want to output all alignments for some --min_lis)
+						if (read.hits_align_info.alignv.size() == (uint32_t)opts.num_best_hits)
+						{
+							read.hits_align_info.min_index = findMinIndex(read);
+						}
+
+						// update the index position of the first occurrence of the highest alignment score
+						if (result->score1 > read.hits_align_info.alignv[highest_score_index].score1)
+						{
+							read.hits_align_info.max_index = hits_size - 1;
+						}
+
+						// the maximum possible score for this read has been found
+						if (result->score1 == max_SW_score)
+						{
+							read.max_SW_count++;
+						}
+					}
+
+					free(result); // free result
+					result = NULL;
+				}
+			}//~if (array_size < num_best_hits_gv)
+
+			// all num_best_hits slots have been filled,
+			// replace the alignment having the lowest score
+			else if (result->score1 > read.hits_align_info.alignv[smallest_score_index].score1)
+			{
+				// update max_index to the position of the first occurrence
+				// of the highest scoring alignment
+				if (result->score1 > read.hits_align_info.alignv[highest_score_index].score1)
+					read.hits_align_info.max_index = smallest_score_index;
+
+				// decrement number of reads mapped to database with lower score
+				--readstats.reads_matched_per_db[read.hits_align_info.alignv[smallest_score_index].index_num];
+
+				// increment number of reads mapped to database with higher score
+				++readstats.reads_matched_per_db[index.index_num];
+
+				// replace an old smallest scored alignment with the new one
+				read.hits_align_info.alignv[smallest_score_index] = copyAlignment(result);
+
+				read.hits_align_info.min_index = findMinIndex(read);
+
+				// the maximum possible score for this read has been found
+				if (result->score1 == max_SW_score) {
+					read.max_SW_count++;
+				}
+				
+				free(result); // free result, except the cigar (now new cigar)
+				result = NULL;
+			}
+			else if (result != NULL)
+			{
+				// new alignment has a lower score, destroy it
+				 free(result);
+				 result = 0;
+			}
+		}
+		// an alignment for this read doesn't exist, add the first alignment
+		else
+		{
+			// maximum size of s_align array
+			uint32_t max_size = 0;
+			// create new instance of alignments
+			if ((opts.num_best_hits > 0) && (opts.num_best_hits < BEST_HITS_INCREMENT + 1))
+				max_size = opts.num_best_hits;
+			else 
+				max_size = BEST_HITS_INCREMENT;
+
+			read.hits_align_info.alignv.push_back( copyAlignment(result) );
+
+			// the maximum possible score for this read has been found
+			if (result->score1 == max_SW_score) read.max_SW_count++;
+
+			// free result, except the cigar
+			free(result);
+			result = NULL;
+		}
+	}
+	// output the Nth alignment (set by --num_alignments [INT] parameter)
+	else if (opts.num_alignments > -1)
+	{
+		// add alignment to the read. TODO: check how this affects the old logic
+		read.hits_align_info.alignv.push_back(copyAlignment(result));
+
+		// the maximum possible score for this read has been found
+		if (result->score1 == max_SW_score)
+		{
+			read.max_SW_count++;
+		}
+
+		// update number of alignments to output per read
+		if (opts.num_alignments > 0) {
+			read.num_alignments--; // when 0 reached, alignment output stops
+		}
+
+		// get the edit distance between reference and read (serves for
+		// SAM output and computing %id and %query coverage)
+		uint32_t id = 0;
+		uint32_t mismatches = 0;
+		uint32_t gaps = 0;
+		read.calcMismatchGapId(refs, read.hits_align_info.alignv.size()-1, mismatches, gaps, id);
+
+		int32_t align_len = abs(result->read_end1 + 1 - result->read_begin1);
+		int32_t total_pos = mismatches + gaps + id;
+		stringstream ss;
+		ss.precision(3);
+		ss << (double)id / total_pos << ' ' << (double)align_len / read.sequence.length();
+
+		// TODO: ---------------------------------------->
+		// the 'if' below seems to be always false 
+		double align_id_round = 0.0;
+		double align_cov_round = 0.0;
+		ss >> align_id_round >> align_cov_round;
+
+		// the alignment passed the %id and %query coverage threshold
+		if ( align_id_round >= opts.min_id && align_cov_round >= opts.min_cov && read_to_count)
+		{
+			if (!readstats.is_total_reads_mapped_cov)
+				++readstats.total_reads_mapped_cov; // also calculated in post-processor 'computeStats'
+			read_to_count = false;
+
+			// do not output read for de novo OTU clustering
+			// it passed the %id/coverage thersholds
+			if (opts.is_de_novo_otu) read.is_denovo = false;
+		}
+		// <----------------------------------------- TODO
+
+		if (result != 0) 
+		{
+			free(result); // free alignment info
+			result = 0;
+		}
+	}//~if output all alignments
+} // ~store_alignment
+
+/*
+ * level two of the hierarchical search (OPT_CLUSTER_ID): align the read to the members of the centroid
+ * it aligned to. The members are near identical to the centroid, so the read is aligned to the member
+ * region around the diagonal of the centroid alignment, widened by the edges and the length difference
+ *
+ * @param diag            reference position of the read start on the centroid
+ * @param centroid_score  predicts the member scores (see 'plan_score_size')
+ */
+static void align_members(Read & read, Runopts & opts, Index & index, References & refs, Readstats & readstats, Refstats & refstats,
+	AlignScratch & scratch, uint32_t centroid, int64_t diag, int64_t centroid_score, uint32_t edges, uint32_t max_SW_score, bool & read_to_count)
+{
+	int64_t readlen = read.sequence.length();
+	int64_t centroid_len = refs.sequence(centroid).length();
+	auto members = index.clusters.members(centroid);
+
+	// a single profile of the whole read for all the members. The read is in 04 encoding (see the centroid alignment)
+	int8_t score_size = plan_score_size(read, readlen, centroid_score);
+	s_profile* profile = ssw_init((int8_t*)(&read.isequence[0]), readlen, &read.scoring_matrix[0], 5, score_size);
+	for (uint32_t i = 0; i < index.clusters.num_members(centroid); ++i)
+	{
+		if (opts.num_best_hits != 0 && read.max_SW_count == opts.num_best_hits) break;
+		if (opts.num_alignments > 0 && read.num_alignments <= 0) break;
+		if (opts.is_read_budget && scratch.budget.check(opts)) break;
+
+		auto member = members[i];
+		auto ref = refs.sequence(member);
+		int64_t slack = edges + std::abs(static_cast<int64_t>(ref.length()) - centroid_len);
+		int64_t ref_start = std::max<int64_t>(0, diag - slack);
+		int64_t ref_end = std::min<int64_t>(ref.length(), diag + readlen + slack);
+		if (ref_end <= ref_start) continue;
+
+		s_align* result = 0;
+		{
+			PerfScope perf_sw(PerfStage::SW);
+			if (read_diag) ++read_diag->sw_calls;
+			++readstats.cluster_members_tried;
+			scratch.budget.sw_cells += static_cast<uint64_t>(readlen) * (ref_end - ref_start);
+			result = ssw_align(
+				profile,
+				(int8_t*)ref.data() + ref_start,
+				static_cast<int32_t>(ref_end - ref_start),
+				opts.gap_open,
+				opts.gap_extension,
+				2,
+				refstats.minimal_score[index.index_num],
+				0,
+				0
+			);
+		}
+		count_score_size(read, readstats, score_size, result);
+
+		if (result == 0) continue;
+		if (result->score1 <= refstats.minimal_score[index.index_num])
+		{
+			free(result);
+			continue;
+		}
+
+		++readstats.cluster_members_aligned;
+		result->ref_begin1 += ref_start;
+		result->ref_end1 += ref_start;
+		result->readlen = read.sequence.length();
+		result->ref_seq = member;
+		result->index_num = index.index_num;
+		result->part = index.part;
+		result->strand = !read.reversed;
+		store_alignment(read, opts, index, refs, readstats, result, max_SW_score, read_to_count);
+	}
+	init_destroy(&profile);
+} // ~align_members
+
 /* 
  * called on each idx * part * read * strand * [1..max opts.skiplengths[index_num].size (3 by default)] 
  */
 void compute_lis_alignment
 	(
 		Read & read, Runopts & opts, Index & index, References & refs, Readstats & readstats, Refstats & refstats,
+		AlignScratch & scratch,
 		bool & search,
 		uint32_t max_SW_score,
 		bool& read_to_count
@@ -109,19 +538,33 @@ void compute_lis_alignment
 	// the read and a candidate reference sequence
 	bool aligned = false;
 
+	if (read_diag) ++read_diag->passes;
+
 	// if the number of matching windows on the read is less than the threshold => return
 	// default seed_hits = 2
 	if (read.readhit < (uint32_t)opts.seed_hits)
 		return;
 
-	// map <reference number : number of the k-mer occurrences>
-	map<uint32_t, uint32_t> kmer_count_map;
-	// vector to hold 'kmer_count_map' content for Sorting (as map cannot be sorted)
-	vector<uint32pair> kmer_count_vec;
-	map<uint32_t, uint32_t>::iterator map_it;
+	// the members of the aligned centroids are aligned too (OPT_CLUSTER_ID) if more than the first alignment may be output,
+	// or the %id/%cov thresholds (OTU picking) are checked: a read identical to a member may be under them on the centroid
+	bool is_expand = index.clusters.is_loaded() && (opts.num_best_hits != 1 || opts.is_sam || opts.is_blast
+		|| opts.is_otu_map || opts.is_de_novo_otu || opts.min_id > 0 || opts.min_cov > 0);
+
+	PerfScope perf_lis(PerfStage::LIS);
+
+	// number of the k-mer occurrences per reference. Zeroed again below for the next call
+	auto & kmer_count = scratch.kmer_count;
+	auto & kmer_refs = scratch.kmer_refs; // references with non-zero count
+	// candidate references (reference : number of the k-mer occurrences) for sorting
+	auto & kmer_count_vec = scratch.kmer_count_vec;
 	uint32_t max_ref = 0; // reference with max kmer occurrences
 	uint32_t max_occur = 0; // number of kmer occurrences on the 'max_ref'
 
+	if (kmer_count.size() < refs.size())
+		kmer_count.resize(refs.size(), 0);
+	kmer_refs.clear();
+	kmer_count_vec.clear();
+
 	// 1. Find all candidate references by using Read's kmer hits information.
 	//    For every reference, compute the number of kmer hits belonging to it
 	for (auto hit : read.id_win_hits)
@@ -131,22 +574,19 @@ void compute_lis_alignment
 		for (uint32_t j = 0; j < index.positions_tbl[hit.id].size; j++)
 		{
 			uint32_t seq = positions_tbl_ptr++->seq;
-			if ((map_it = kmer_count_map.find(seq)) != kmer_count_map.end())
-				map_it->second++; // sequence already in the map, increment its frequency value
-			else
-				kmer_count_map[seq] = 1; // sequence not in the map, add it
+			if (kmer_count[seq]++ == 0)
+				kmer_refs.push_back(seq); // first occurrence on the sequence
 		}
 	}
 
-	// copy frequency map to vector for sorting
 	// consider only candidate references that have enough seed hits
-	for (auto freq_pair: kmer_count_map)
+	for (auto seq : kmer_refs)
 	{
-		if (freq_pair.second >= (uint32_t)opts.seed_hits)
-			kmer_count_vec.push_back(freq_pair);
+		if (kmer_count[seq] >= (uint32_t)opts.seed_hits)
+			kmer_count_vec.push_back(uint32pair(seq, kmer_count[seq]));
+		kmer_count[seq] = 0;
 	}
-
-	kmer_count_map.clear();
+	if (read_diag) read_diag->candidates += static_cast<uint32_t>(kmer_count_vec.size());
 
 	// sort sequences by frequency in descending order
 	std::sort(kmer_count_vec.begin(), kmer_count_vec.end(),
@@ -159,6 +599,16 @@ void compute_lis_alignment
 	// 2. for each reference sequence candidate, starting from the highest scoring.
 	for (uint32_t k = 0; k < kmer_count_vec.size(); k++)
 	{
+		// the work budget of the read is used up - keep the alignments found so far
+		if (opts.is_read_budget)
+		{
+			if (scratch.budget.check(opts)) {
+				search = false;
+				break;
+			}
+			++scratch.budget.candidates;
+		}
+
 		// the maximum scoring alignment has been found - stop searching for more alignments
 		if (opts.num_best_hits != 0 && read.max_SW_count == opts.num_best_hits) {
 			break;
@@ -196,7 +646,9 @@ void compute_lis_alignment
 		//	[3] : (674, 18)
 		//         |    |_k-mer position on the read
 		//         |_k-mer position on the reference
-		vector<uint32pair> hits_per_ref;
+		auto & hits_per_ref = scratch.hits_per_ref;
+		hits_per_ref.clear();
+		bool is_expanded = false; // the members of 'max_ref' were aligned (OPT_CLUSTER_ID)
 
 		//
 		// 3. populate 'hits_per_ref'
@@ -226,7 +678,8 @@ void compute_lis_alignment
 		// iterate over the set of hits, output windows of
 		// length == read which have at least ratio hits
 		vector<uint32pair>::iterator hits_per_ref_iter = hits_per_ref.begin();
-		deque<uint32pair> match_chain; // chain of matching k-mers fit along the read length window
+		auto & match_chain = scratch.match_chain; // chain of matching k-mers fit along the read length window
+		match_chain.clear();
 
 		// 4. run a sliding window of read's length across the reference, 
 		//    searching for windows with enough k-mer hits
@@ -241,7 +694,7 @@ void compute_lis_alignment
 		while (hits_per_ref_iter != hits_per_ref.end())
 		{
 			// TODO: should it be
-			auto stop_ref = begin_ref + read.sequence.length() - begin_read - refstats.lnwin[index.index_num] + 1; // position on reference
+			auto stop_ref = begin_ref + read.sequence.length() - begin_read - refstats.win_span[index.index_num] + 1; // position on reference
 			//uint32_t stop_ref = begin_ref + read.sequence.length() - refstats.lnwin[index.index_num] + 1; // wrong?
 			bool push = false;
 			while ( hits_per_ref_iter != hits_per_ref.end() && hits_per_ref_iter->first <= stop_ref )
@@ -264,8 +717,9 @@ void compute_lis_alignment
 			// enough windows at this position on genome to search for LIS
 			if (match_chain.size() >= (uint32_t)opts.seed_hits)
 			{
-				vector<uint32_t> lis_arr; // array of Indices of matches from the match_chain comprising the LIS
-				find_lis(match_chain, lis_arr);
+				auto & lis_arr = scratch.lis_arr; // array of Indices of matches from the match_chain comprising the LIS
+				lis_arr.clear();
+				find_lis(match_chain.data(), match_chain.size(), lis_arr, scratch.lis_p);
 #ifdef HEURISTIC1_OFF
 				uint32_t list_n = 0;
 				do
@@ -288,7 +742,7 @@ void compute_lis_alignment
 						std::size_t align_ref_start = 0;
 						std::size_t align_que_start = 0;
 						std::size_t align_length = 0;
-						auto reflen = refs.buffer[max_ref].sequence.length();
+						auto reflen = refs.sequence(max_ref).length();
 						uint32_t edges = 0;
 						if (opts.is_as_percent)
 							edges = (((double)opts.edges / 100.0)*read.sequence.length());
@@ -374,27 +828,38 @@ void compute_lis_alignment
 						if (read.is03) 
 							read.flip34();
                        
-						// create profile for read
-						s_profile* profile = 0;
-						profile = ssw_init((int8_t*)(&read.isequence[0] + align_que_start), (align_length - head - tail), &read.scoring_matrix[0], 5, 2);
-
-						s_align* result = 0;
-
-						result = ssw_align(
-							profile,
-							(int8_t*)refs.buffer[max_ref].sequence.c_str() + align_ref_start - head,
-							align_length,
-							opts.gap_open,
-							opts.gap_extension,
-							2,
-							refstats.minimal_score[index.index_num], // minimal_score_index_num
-							0,
-							0
-						);
-
-						// deallocate memory for profile, no longer needed
-						if (profile != 0) 
-							init_destroy(&profile);
+						s_align* result = near_exact_alignment(read, opts, refs.sequence(max_ref), match_chain, lis_arr, align_ref_start - head);
+						if (result != 0)
+							++readstats.near_exact_aligned;
+						else
+						{
+							PerfScope perf_sw(PerfStage::SW);
+							if (read_diag) ++read_diag->sw_calls;
+
+							// create profile for read. 8 or 16-bit from the length and the seeds
+							uint32_t query_len = align_length - head - tail;
+							int8_t score_size = plan_score_size(read, query_len, seed_score(read, match_chain, lis_arr, refstats.lnwin[index.index_num] + 1));
+							s_profile* profile = 0;
+							profile = ssw_init((int8_t*)(&read.isequence[0] + align_que_start), query_len, &read.scoring_matrix[0], 5, score_size);
+
+							scratch.budget.sw_cells += static_cast<uint64_t>(align_length - head - tail) * align_length;
+							result = ssw_align(
+								profile,
+								(int8_t*)refs.sequence(max_ref).data() + align_ref_start - head,
+								align_length,
+								opts.gap_open,
+								opts.gap_extension,
+								2,
+								refstats.minimal_score[index.index_num], // minimal_score_index_num
+								0,
+								0
+							);
+
+							// deallocate memory for profile, no longer needed
+							if (profile != 0) 
+								init_destroy(&profile);
+							count_score_size(read, readstats, score_size, result);
+						}
 
 						// check alignment satisfies all thresholds
 						if ( result != 0 && result->score1 > refstats.minimal_score[index.index_num] )
@@ -404,15 +869,6 @@ void compute_lis_alignment
 						// the alignment and go to next alignment
 						if (aligned)
 						{
-							// read has not been yet mapped, set bit to true for this read
-							// (this is the Only place where read_hits can be modified)
-							if (!read.is_hit)
-							{
-								read.is_hit = true;
-								++readstats.total_reads_aligned;
-								++readstats.reads_matched_per_db[index.index_num];
-							}
-
 							// add the offset calculated by the LCS (from the beginning of the sequence)
 							// to the offset computed by SW alignment
 							result->ref_begin1 += (align_ref_start - head);
@@ -426,173 +882,16 @@ void compute_lis_alignment
 							result->part = index.part;
 							result->strand = !read.reversed; // flag whether the alignment was done on a forward or reverse strand
 
-							// update best alignment
-							if (opts.min_lis > -1)
+							int64_t diag = static_cast<int64_t>(result->ref_begin1) - result->read_begin1;
+							int64_t centroid_score = result->score1;
+							store_alignment(read, opts, index, refs, readstats, result, max_SW_score, read_to_count);
+
+							// level two: the members of the centroid
+							if (is_expand && !is_expanded && index.clusters.num_members(max_ref) > 0)
 							{
-								// an alignment for this read already exists
-								if (read.hits_align_info.alignv.size() > 0)
-								{
-									uint32_t smallest_score_index = read.hits_align_info.min_index;
-									uint32_t highest_score_index = read.hits_align_info.max_index;
-									uint32_t hits_size = read.hits_align_info.alignv.size();
-
-									// number of alignments stored per read < 'num_best_hits', 
-									// add alignment to array without comparison to other members of array
-									if (opts.num_best_hits == 0 || hits_size < (uint32_t)opts.num_best_hits)
-									{
-										auto rescopy = copyAlignment(result);
-										if (rescopy == read.hits_align_info.alignv.back())
-											; // skip equivalent alignment
-										else if (rescopy.score1 > read.hits_align_info.alignv.back().score1)
-										{
-											if (rescopy.ref_seq == read.hits_align_info.alignv.back().ref_seq)
-											{
-												read.hits_align_info.alignv.back() = rescopy; // replace alignment
-											}
-											else
-											{
-												// add alignment
-												read.hits_align_info.alignv.push_back(rescopy);
-												++hits_size;
-
-												// read alignments are filled to max size, find the smallest
-												// alignment score and set the smallest_score_index
-												// (this is not done when num_best_hits_gv == 0 since
-												// we want to output all alignments for some --min_lis)
-												if (read.hits_align_info.alignv.size() == (uint32_t)opts.num_best_hits)
-												{
-													read.hits_align_info.min_index = findMinIndex(read);
-												}
-
-												// update the index position of the first occurrence of the highest alignment score
-												if (result->score1 > read.hits_align_info.alignv[highest_score_index].score1)
-												{
-													read.hits_align_info.max_index = hits_size - 1;
-												}
-
-												// the maximum possible score for this read has been found
-												if (result->score1 == max_SW_score)
-												{
-													read.max_SW_count++;
-												}
-											}
-
-											free(result); // free result
-											result = NULL;
-										}
-									}//~if (array_size < num_best_hits_gv)
-
-									// all num_best_hits slots have been filled,
-									// replace the alignment having the lowest score
-									else if (result->score1 > read.hits_align_info.alignv[smallest_score_index].score1)
-									{
-										// update max_index to the position of the first occurrence
-										// of the highest scoring alignment
-										if (result->score1 > read.hits_align_info.alignv[highest_score_index].score1)
-											read.hits_align_info.max_index = smallest_score_index;
-
-										// decrement number of reads mapped to database with lower score
-										--readstats.reads_matched_per_db[read.hits_align_info.alignv[smallest_score_index].index_num];
-
-										// increment number of reads mapped to database with higher score
-										++readstats.reads_matched_per_db[index.index_num];
-
-										// replace an old smallest scored alignment with the new one
-										read.hits_align_info.alignv[smallest_score_index] = copyAlignment(result);
-
-										read.hits_align_info.min_index = findMinIndex(read);
-
-										// the maximum possible score for this read has been found
-										if (result->score1 == max_SW_score) {
-											read.max_SW_count++;
-										}
-										
-										free(result); // free result, except the cigar (now new cigar)
-										result = NULL;
-									}
-									else if (result != NULL)
-									{
-										// new alignment has a lower score, destroy it
-										 free(result);
-										 result = 0;
-									}
-								}
-								// an alignment for this read doesn't exist, add the first alignment
-								else
-								{
-									// maximum size of s_align array
-									uint32_t max_size = 0;
-									// create new instance of alignments
-									if ((opts.num_best_hits > 0) && (opts.num_best_hits < BEST_HITS_INCREMENT + 1))
-										max_size = opts.num_best_hits;
-									else 
-										max_size = BEST_HITS_INCREMENT;
-
-									read.hits_align_info.alignv.push_back( copyAlignment(result) );
-
-									// the maximum possible score for this read has been found
-									if (result->score1 == max_SW_score) read.max_SW_count++;
-
-									// free result, except the cigar
-									free(result);
-									result = NULL;
-								}
+								is_expanded = true;
+								align_members(read, opts, index, refs, readstats, refstats, scratch, max_ref, diag, centroid_score, edges, max_SW_score, read_to_count);
 							}
-							// output the Nth alignment (set by --num_alignments [INT] parameter)
-							else if (opts.num_alignments > -1)
-							{
-								// add alignment to the read. TODO: check how this affects the old logic
-								read.hits_align_info.alignv.push_back(copyAlignment(result));
-
-								// the maximum possible score for this read has been found
-								if (result->score1 == max_SW_score)
-								{
-									read.max_SW_count++;
-								}
-
-								// update number of alignments to output per read
-								if (opts.num_alignments > 0) {
-									read.num_alignments--; // when 0 reached, alignment output stops
-								}
-
-								// get the edit distance between reference and read (serves for
-								// SAM output and computing %id and %query coverage)
-								uint32_t id = 0;
-								uint32_t mismatches = 0;
-								uint32_t gaps = 0;
-								read.calcMismatchGapId(refs, read.hits_align_info.alignv.size()-1, mismatches, gaps, id);
-
-								int32_t align_len = abs(result->read_end1 + 1 - result->read_begin1);
-								int32_t total_pos = mismatches + gaps + id;
-								stringstream ss;
-								ss.precision(3);
-								ss << (double)id / total_pos << ' ' << (double)align_len / read.sequence.length();
-
-								// TODO: ---------------------------------------->
-								// the 'if' below seems to be always false 
-								double align_id_round = 0.0;
-								double align_cov_round = 0.0;
-								ss >> align_id_round >> align_cov_round;
-
-								// the alignment passed the %id and %query coverage threshold
-								if ( align_id_round >= opts.min_id && align_cov_round >= opts.min_cov && read_to_count)
-								{
-									if (!readstats.is_total_reads_mapped_cov)
-										++readstats.total_reads_mapped_cov; // also calculated in post-processor 'computeStats'
-									read_to_count = false;
-
-									// do not output read for de novo OTU clustering
-									// it passed the %id/coverage thersholds
-									if (opts.is_de_novo_otu) read.is_denovo = false;
-								}
-								// <----------------------------------------- TODO
-
-								if (result != 0) 
-								{
-									free(result); // free alignment info
-									result = 0;
-								}
-							}//~if output all alignments
 
 							// continue to next read (do not need to collect more seeds using another pass)
 							search = false;
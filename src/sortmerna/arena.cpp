@@ -0,0 +1,204 @@
+/**
+ * FILE: arena.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <cstdlib>
+#include <cstdint>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "common.hpp"
+#include "arena.hpp"
+
+namespace {
+	enum { MODE_OFF, MODE_THP, MODE_HUGETLB };
+	int mode = MODE_THP;
+	bool is_hugetlb_warned = false;
+	const std::size_t HUGE_PAGE = 2 * 1024 * 1024; // x86_64 and aarch64 (4K base pages) default huge page
+	const std::size_t CHUNK_SIZE = 32 * HUGE_PAGE;
+
+	std::size_t round_up(std::size_t val, std::size_t to) { return (val + to - 1) / to * to; }
+
+	const char *mode_name() { return mode == MODE_OFF ? "off" : mode == MODE_THP ? "thp" : "hugetlb"; }
+}
+
+void Arena::set_mode(const std::string &val)
+{
+	mode = val == "off" ? MODE_OFF : val == "hugetlb" ? MODE_HUGETLB : MODE_THP;
+}
+
+void Arena::advise(void *ptr, std::size_t len)
+{
+#if defined(MADV_HUGEPAGE)
+	if (mode == MODE_OFF) return;
+	// only the huge page aligned part of the buffer can be backed by huge pages
+	auto beg = round_up(reinterpret_cast<std::uintptr_t>(ptr), HUGE_PAGE);
+	auto end = (reinterpret_cast<std::uintptr_t>(ptr) + len) / HUGE_PAGE * HUGE_PAGE;
+	if (end > beg)
+		madvise(reinterpret_cast<void*>(beg), end - beg, MADV_HUGEPAGE);
+#endif
+}
+
+void *Arena::alloc(std::size_t bytes, std::size_t align)
+{
+	if (bytes == 0) return nullptr;
+	if (chunks.empty() || round_up(chunks.back().used, align) + bytes > chunks.back().size)
+		add_chunk(bytes);
+	auto &chunk = chunks.back();
+	chunk.used = round_up(chunk.used, align);
+	void *ptr = chunk.ptr + chunk.used;
+	chunk.used += bytes;
+	used_bytes += bytes;
+	return ptr;
+}
+
+void Arena::add_chunk(std::size_t min_bytes)
+{
+	Chunk chunk = { nullptr, round_up(std::max(min_bytes, CHUNK_SIZE), HUGE_PAGE), 0, false, false };
+#if defined(MAP_HUGETLB)
+	if (mode == MODE_HUGETLB)
+	{
+		void *ptr = mmap(nullptr, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (ptr != MAP_FAILED)
+		{
+			chunk.ptr = static_cast<char*>(ptr);
+			chunk.is_mmap = true;
+			chunk.is_hugetlb = true;
+		}
+		else if (!is_hugetlb_warned)
+		{
+			is_hugetlb_warned = true;
+			std::stringstream ss;
+			ss << STAMP << "Failed to map " << chunk.size << " bytes of explicit huge pages (check vm.nr_hugepages)."
+				<< " Using transparent huge pages.";
+			WARN(ss.str());
+		}
+	}
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+	if (chunk.ptr == nullptr)
+	{
+		void *ptr = mmap(nullptr, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr != MAP_FAILED)
+		{
+			chunk.ptr = static_cast<char*>(ptr);
+			chunk.is_mmap = true;
+			advise(ptr, chunk.size); // before the pages are touched
+		}
+	}
+#endif
+	if (chunk.ptr == nullptr)
+		chunk.ptr = static_cast<char*>(std::calloc(chunk.size, 1));
+
+	if (chunk.ptr == nullptr)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to allocate " << chunk.size << " bytes for the index arena";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	chunks.push_back(chunk);
+} // ~Arena::add_chunk
+
+void Arena::clear()
+{
+	for (auto &chunk : chunks)
+	{
+#if defined(__linux__) || defined(__APPLE__)
+		if (chunk.is_mmap)
+		{
+			munmap(chunk.ptr, chunk.size);
+			continue;
+		}
+#endif
+		std::free(chunk.ptr);
+	}
+	chunks.clear();
+	used_bytes = 0;
+}
+
+std::size_t Arena::reserved() const
+{
+	std::size_t bytes = 0;
+	for (auto const &chunk : chunks)
+		bytes += chunk.size;
+	return bytes;
+}
+
+/**
+ * hugetlb chunks are huge pages by definition. For the rest the AnonHugePages of the mappings
+ * in /proc/self/smaps are attributed to the chunks by the share of the mapping they cover
+ * (adjacent chunks can be merged into a single mapping by the kernel).
+ */
+std::size_t Arena::huge_bytes() const
+{
+	std::size_t bytes = 0;
+	bool is_scan = false;
+	for (auto const &chunk : chunks)
+	{
+		if (chunk.is_hugetlb) bytes += chunk.size;
+		else if (chunk.is_mmap) is_scan = true;
+	}
+#if defined(__linux__)
+	if (!is_scan) return bytes;
+
+	std::ifstream smaps("/proc/self/smaps");
+	std::string line;
+	std::size_t overlap = 0; // bytes of the current mapping covered by the chunks
+	std::size_t map_size = 0;
+	while (std::getline(smaps, line))
+	{
+		auto dash = line.find('-');
+		auto space = line.find(' ');
+		if (dash != std::string::npos && space != std::string::npos && dash < space
+			&& line.find_first_not_of("0123456789abcdef") == dash)
+		{
+			// mapping header 'start-end perms offset dev inode path'
+			std::uintptr_t beg = std::stoull(line.substr(0, dash), nullptr, 16);
+			std::uintptr_t end = std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+			map_size = end - beg;
+			overlap = 0;
+			for (auto const &chunk : chunks)
+			{
+				if (!chunk.is_mmap || chunk.is_hugetlb) continue;
+				auto cbeg = reinterpret_cast<std::uintptr_t>(chunk.ptr);
+				auto cend = cbeg + chunk.size;
+				if (cbeg < end && cend > beg)
+					overlap += std::min(cend, end) - std::max(cbeg, beg);
+			}
+		}
+		else if (overlap > 0 && line.compare(0, 14, "AnonHugePages:") == 0)
+		{
+			std::size_t kb = std::stoull(line.substr(14));
+			bytes += static_cast<std::size_t>(static_cast<double>(kb) * 1024 * overlap / map_size);
+		}
+	}
+#endif
+	return bytes;
+} // ~Arena::huge_bytes
+
+std::string Arena::report(const std::vector<std::pair<std::string, const Arena*>> &arenas)
+{
+	std::stringstream ss;
+	ss << STAMP << "Huge pages [" << mode_name() << "]:" << std::setprecision(2) << std::fixed;
+	for (auto const &arena : arenas)
+	{
+		auto used = arena.second->size(); // the unused tail of a chunk is never touched i.e. not backed at all
+		auto huge = std::min(arena.second->huge_bytes(), used);
+		ss << " " << arena.first << " " << used / 1048576.0 << " MB "
+			<< (used > 0 ? 100.0 * huge / used : 0.0) << "%";
+	}
+	ss << std::endl;
+	return ss.str();
+}
+
+// ~arena.cpp
@@ -0,0 +1,290 @@
+/**
+ * FILE: bam.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <thread>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "zlib.h"
+
+#include "common.hpp"
+#include "gzip.hpp" // RL_OK, RL_END, RL_ERR
+#include "bam.hpp"
+
+namespace {
+	const std::size_t BGZF_FOOTER = 8; // CRC32 + ISIZE
+	const std::size_t BAM_IN_SIZE = 1U << 22; // file input chunk size
+	const std::size_t BAM_CORE = 32; // fixed part of a record after 'block_size'
+	const char *SEQ_NT16 = "=ACMGRSVTWYHKDBN";
+
+	template <typename T> T get(const char *ptr)
+	{
+		T val;
+		std::memcpy(&val, ptr, sizeof(T)); // BAM is little endian
+		return val;
+	}
+
+	// size of the BGZF block at 'ptr' (0 if not a BGZF block), or 1 if more bytes are needed to tell
+	std::size_t block_size(const char *ptr, std::size_t len)
+	{
+		if (len < 12) return 1;
+		auto *p = reinterpret_cast<const unsigned char*>(ptr);
+		if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4)) // FLG.FEXTRA
+			return 0;
+		std::size_t xlen = get<uint16_t>(ptr + 10);
+		if (len < 12 + xlen) return 1;
+		for (std::size_t i = 12; i + 4 <= 12 + xlen; )
+		{
+			std::size_t slen = get<uint16_t>(ptr + i + 2);
+			if (p[i] == 'B' && p[i + 1] == 'C' && slen == 2)
+				return std::size_t(get<uint16_t>(ptr + i + 4)) + 1; // BSIZE: total block size - 1
+			i += 4 + slen;
+		}
+		return 0;
+	}
+
+	// inflate a single BGZF block
+	bool inflate_block(const char *ptr, std::size_t size, std::string &out)
+	{
+		std::size_t xlen = get<uint16_t>(ptr + 10);
+		if (size < 12 + xlen + BGZF_FOOTER) return false;
+		out.resize(get<uint32_t>(ptr + size - 4)); // ISIZE
+
+		z_stream strm = {};
+		if (inflateInit2(&strm, -15) != Z_OK) // raw deflate
+			return false;
+		strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(ptr + 12 + xlen));
+		strm.avail_in = static_cast<uInt>(size - 12 - xlen - BGZF_FOOTER);
+		strm.next_out = reinterpret_cast<Bytef*>(&out[0]);
+		strm.avail_out = static_cast<uInt>(out.size());
+		auto ret = inflate(&strm, Z_FINISH);
+		inflateEnd(&strm);
+		return ret == Z_STREAM_END && strm.avail_out == 0
+			&& crc32(0, reinterpret_cast<const Bytef*>(out.data()), static_cast<uInt>(out.size())) == get<uint32_t>(ptr + size - 8);
+	}
+}
+
+bool Bam::read_in(std::istream &ifs)
+{
+	in.erase(in.begin(), in.begin() + in_pos);
+	in_pos = 0;
+	if (is_eof)
+		return false;
+
+	auto size = in.size();
+	in.resize(size + BAM_IN_SIZE);
+	ifs.read(in.data() + size, BAM_IN_SIZE);
+	auto num = static_cast<std::size_t>(ifs.gcount());
+	in.resize(size + num);
+	if (num < BAM_IN_SIZE)
+		is_eof = true;
+	return num > 0;
+} // ~Bam::read_in
+
+/*
+ * inflate the next batch of the BGZF blocks and append to 'text'
+ *
+ * @return RL_OK | RL_END (no more blocks) | RL_ERR
+ */
+int Bam::inflate_batch(std::istream &ifs)
+{
+	std::vector<std::pair<std::size_t, std::size_t>> blocks; // offset into 'in', size
+	for (;;)
+	{
+		blocks.clear();
+		bool is_more = false; // the last block is incomplete
+		for (auto off = in_pos; off < in.size() && blocks.size() < BAM_BATCH_BLOCKS; )
+		{
+			auto size = block_size(in.data() + off, in.size() - off);
+			if (size == 0)
+			{
+				ERR("BAM: not a BGZF block at the input offset " + std::to_string(off));
+				return RL_ERR;
+			}
+			if (size == 1 || off + size > in.size())
+			{
+				is_more = true;
+				break;
+			}
+			blocks.emplace_back(off, size);
+			off += size;
+		}
+		if (blocks.size() == BAM_BATCH_BLOCKS || (!blocks.empty() && !is_more) || is_eof)
+			break;
+		read_in(ifs); // invalidates the offsets - collect again
+	}
+
+	if (blocks.empty())
+	{
+		if (in_pos == in.size())
+			return RL_END;
+		ERR("BAM: truncated BGZF block at the end of the file");
+		return RL_ERR;
+	}
+
+	std::vector<std::string> outs(blocks.size());
+	std::vector<char> is_ok(blocks.size(), 0);
+	auto decode = [this, &blocks, &outs, &is_ok](std::size_t first, std::size_t step) {
+		for (auto i = first; i < blocks.size(); i += step)
+			is_ok[i] = inflate_block(in.data() + blocks[i].first, blocks[i].second, outs[i]);
+	};
+
+	std::size_t num_threads = std::min<std::size_t>({ BAM_THREADS, blocks.size(), std::max(1U, std::thread::hardware_concurrency()) });
+	std::vector<std::thread> threads;
+	for (std::size_t i = 1; i < num_threads; ++i)
+		threads.emplace_back(decode, i, num_threads);
+	decode(0, num_threads);
+	for (auto &thread : threads)
+		thread.join();
+
+	for (std::size_t i = 0; i < blocks.size(); ++i)
+	{
+		if (!is_ok[i])
+		{
+			ERR("BAM: failed to inflate the BGZF block at the input offset " + std::to_string(blocks[i].first));
+			return RL_ERR;
+		}
+		text += outs[i];
+	}
+	in_pos = blocks.back().first + blocks.back().second;
+	return RL_OK;
+} // ~Bam::inflate_batch
+
+int Bam::fill(std::istream &ifs, std::size_t num)
+{
+	if (text.size() - pos >= num)
+		return RL_OK;
+
+	text.erase(0, pos);
+	pos = 0;
+	while (text.size() < num)
+	{
+		auto ret = inflate_batch(ifs);
+		if (ret == RL_ERR)
+			return RL_ERR;
+		if (ret == RL_END)
+			return text.empty() ? RL_END : RL_ERR; // a partial record
+	}
+	return RL_OK;
+} // ~Bam::fill
+
+/*
+ * skip the header: magic, SAM text, references
+ */
+int Bam::skip_header(std::istream &ifs)
+{
+	if (fill(ifs, 8) != RL_OK || text.compare(pos, 4, "BAM\1", 4) != 0)
+	{
+		ERR("BAM: missing the BAM magic");
+		return RL_ERR;
+	}
+	std::size_t l_text = get<uint32_t>(text.data() + pos + 4);
+	pos += 8;
+	if (fill(ifs, l_text + 4) != RL_OK) return RL_ERR;
+	pos += l_text;
+	auto n_ref = get<uint32_t>(text.data() + pos);
+	pos += 4;
+	for (uint32_t i = 0; i < n_ref; ++i)
+	{
+		if (fill(ifs, 4) != RL_OK) return RL_ERR;
+		std::size_t l_name = get<uint32_t>(text.data() + pos);
+		if (fill(ifs, 4 + l_name + 4) != RL_OK) return RL_ERR;
+		pos += 4 + l_name + 4; // l_name, name, l_ref
+	}
+	is_header = true;
+	return RL_OK;
+} // ~Bam::skip_header
+
+int Bam::next(std::istream &ifs, BamRecord &rec)
+{
+	if (!is_header && skip_header(ifs) != RL_OK)
+		return RL_ERR;
+
+	for (;;)
+	{
+		auto ret = fill(ifs, 4);
+		if (ret != RL_OK)
+			return ret;
+		std::size_t rec_size = get<uint32_t>(text.data() + pos);
+		if (rec_size < BAM_CORE || fill(ifs, 4 + rec_size) != RL_OK)
+		{
+			ERR("BAM: truncated or invalid record");
+			return RL_ERR;
+		}
+
+		const char *ptr = text.data() + pos + 4;
+		std::size_t l_read_name = static_cast<uint8_t>(ptr[8]);
+		std::size_t n_cigar_op = get<uint16_t>(ptr + 12);
+		rec.flag = get<uint16_t>(ptr + 14);
+		std::size_t l_seq = get<uint32_t>(ptr + 16);
+		pos += 4 + rec_size;
+
+		if (BAM_CORE + l_read_name + 4 * n_cigar_op + (l_seq + 1) / 2 + l_seq > rec_size)
+		{
+			ERR("BAM: invalid record sizes");
+			return RL_ERR;
+		}
+		if (rec.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))
+			continue;
+
+		const char *name = ptr + BAM_CORE;
+		rec.name.assign(name, l_read_name > 0 ? l_read_name - 1 : 0); // NUL terminated
+
+		const auto *seq = reinterpret_cast<const unsigned char*>(name + l_read_name + 4 * n_cigar_op);
+		rec.sequence.resize(l_seq);
+		for (std::size_t i = 0; i < l_seq; ++i)
+			rec.sequence[i] = SEQ_NT16[(i & 1) ? (seq[i / 2] & 0xf) : (seq[i / 2] >> 4)];
+
+		const auto *qual = seq + (l_seq + 1) / 2;
+		rec.quality.clear();
+		if (l_seq > 0 && qual[0] != 0xff)
+		{
+			rec.quality.resize(l_seq);
+			for (std::size_t i = 0; i < l_seq; ++i)
+				rec.quality[i] = static_cast<char>(qual[i] + 33);
+		}
+
+		if (rec.flag & BAM_FREVERSE)
+		{
+			// stored reverse complemented - revert to the read as sequenced
+			std::reverse(rec.sequence.begin(), rec.sequence.end());
+			std::transform(rec.sequence.begin(), rec.sequence.end(), rec.sequence.begin(), [](char nt) {
+				switch (nt) {
+				case 'A': return 'T';
+				case 'C': return 'G';
+				case 'G': return 'C';
+				case 'T': return 'A';
+				default: return nt;
+				}
+			});
+			std::reverse(rec.quality.begin(), rec.quality.end());
+		}
+		return RL_OK;
+	}
+} // ~Bam::next
+
+bool Bam::detect(std::istream &ifs, bool &is_paired)
+{
+	bool is_bam = false;
+	is_paired = false;
+	{
+		Bam bam;
+		// check the first block before inflating to keep quiet on the other files
+		if (bam.read_in(ifs) && block_size(bam.in.data(), bam.in.size()) > 1 && bam.fill(ifs, 4) == RL_OK && bam.text.compare(0, 4, "BAM\1", 4) == 0)
+		{
+			is_bam = true;
+			BamRecord rec;
+			if (bam.next(ifs, rec) == RL_OK)
+				is_paired = rec.flag & BAM_FPAIRED;
+		}
+	}
+	ifs.clear();
+	ifs.seekg(0);
+	return is_bam;
+} // ~Bam::detect
+
+// ~bam.cpp
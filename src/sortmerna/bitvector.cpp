@@ -45,14 +45,18 @@ UCHAR mask_3 = 7;
 
 /*               
  * initialize forward (prefix) bitvector
+ * NUMBVS > 0 - compile time number of bitvectors (the 'numbvs' argument is ignored), 0 - runtime 'numbvs'
  */
+template <int NUMBVS>
 void 
-init_win_f (
+init_win_f_n (
 	char* ptrf, 
 	UCHAR* bittable_000,
 	UCHAR* bittable_010,
 	int numbvs)
 {
+	if (NUMBVS > 0) numbvs = NUMBVS;
+
 	/// [w_1] forward
 
 	UCHAR *reset  = bittable_000;
@@ -81,20 +85,29 @@ init_win_f (
 			setbit = win_ptr2;
 	  	}	
 	}
+}//~init_win_f_n()
+
+void init_win_f(char* ptrf, UCHAR* bittable_000, UCHAR* bittable_010, int numbvs)
+{
+	init_win_f_n<0>(ptrf, bittable_000, bittable_010, numbvs);
 }//~init_win_f()
 
 
 
 /*
  * initialize the rear (suffix) bitvector
+ * NUMBVS - see init_win_f_n
  */
+template <int NUMBVS>
 void 
-init_win_r ( 
+init_win_r_n ( 
 	char* ptrr, 
 	UCHAR* bittable_000,
 	UCHAR* bittable_010,
 	int numbvs )
 {
+	if (NUMBVS > 0) numbvs = NUMBVS;
+
  	/// [w_1] reverse
 
 	UCHAR *reset  = bittable_000;
@@ -122,8 +135,25 @@ init_win_r (
 	  	}
 	}
 
+}//~init_win_r_n()
+
+void init_win_r(char* ptrr, UCHAR* bittable_000, UCHAR* bittable_010, int numbvs)
+{
+	init_win_r_n<0>(ptrr, bittable_000, bittable_010, numbvs);
 }//~init_win_r()
 
+// specializations for the seeds of length 12, 14, 16, 18, 20 i.e. numbvs = 4 * (L/2 - 3) (see select_seed_kernels)
+template void init_win_f_n<12>(char*, UCHAR*, UCHAR*, int);
+template void init_win_f_n<16>(char*, UCHAR*, UCHAR*, int);
+template void init_win_f_n<20>(char*, UCHAR*, UCHAR*, int);
+template void init_win_f_n<24>(char*, UCHAR*, UCHAR*, int);
+template void init_win_f_n<28>(char*, UCHAR*, UCHAR*, int);
+template void init_win_r_n<12>(char*, UCHAR*, UCHAR*, int);
+template void init_win_r_n<16>(char*, UCHAR*, UCHAR*, int);
+template void init_win_r_n<20>(char*, UCHAR*, UCHAR*, int);
+template void init_win_r_n<24>(char*, UCHAR*, UCHAR*, int);
+template void init_win_r_n<28>(char*, UCHAR*, UCHAR*, int);
+
 
 
 /*
@@ -107,12 +107,7 @@ void computeStats(Read & read, Readstats & readstats, Refstats & refstats, Refer
 					if (opts.is_otu_map)
 					{
 						// reference sequence identifier for mapped read
-						std::string refhead = refs.buffer[read.hits_align_info.alignv[p].ref_seq].header;
-						std::string ref_seq_str = refhead.substr(0, refhead.find(' '));
-						// left trim '>' or '@'
-						ref_seq_str.erase(ref_seq_str.begin(),
-							std::find_if(ref_seq_str.begin(), ref_seq_str.end(),
-								[](auto ch) {return !(ch == FASTA_HEADER_START || ch == FASTQ_HEADER_START);}));
+						std::string ref_seq_str(refs.id(read.hits_align_info.alignv[p].ref_seq));
 
 						// read identifier
 						std::string read_seq_str = read.getSeqId();
@@ -172,7 +172,7 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 	bitvec.resize(bitvec_size);
 	std::fill(bitvec.begin(), bitvec.end(), 0);
 
-	init_win_f(&read.isequence[std::stoi(posval) + refstats.partialwin[index.index_num]],
+	index.kernels->init_win_f(&read.isequence[std::stoi(posval) + refstats.partialwin[index.index_num]],
 		&bitvec[0],
 		&bitvec[4],
 		refstats.numbvs[index.index_num]);
@@ -181,7 +181,7 @@ void CmdSession::cmdIndex(Runopts & opts, std::string & cmd)
 	std::vector<id_win> id_hits;
 
 	// search burst-trie
-	traversetrie_align(
+	index.kernels->traversetrie_align(
 		index.lookup_tbl[kmerhash].trie_F,
 		0,
 		0,
@@ -276,9 +276,9 @@ void CmdSession::cmd_max_ref_part(Runopts & opts, std::string & cmd)
 
 	std::cout << " Reference file number: " << idxval 
 		<< " Reference part: " << partval
-		<< " Part size: " << refs.buffer.size()
-		<< " Max Ref ID: " << refs.buffer[refs.buffer.size() - 1].id
-		<< " Max Ref NID: " << refs.buffer[refs.buffer.size() - 1].nid
+		<< " Part size: " << refs.size()
+		<< " Max Ref ID: " << refs.id(refs.size() - 1)
+		<< " Max Ref NID: " << refs.size() - 1
 		<< std::endl;
  
 } // ~CmdSession::cmd_max_ref_part
@@ -0,0 +1,48 @@
+/**
+ * FILE: dust.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <array>
+
+#include "dust.hpp"
+
+std::size_t dust_mask(const char *seq, std::size_t len, uint32_t win_len, double threshold, std::vector<bool> &masked)
+{
+	masked.clear();
+	if (win_len < 4 || len < win_len)
+		return 0;
+
+	std::array<uint32_t, 64> counts = {}; // triplet counts in the window
+	uint64_t pairs = 0; // sum of c * (c - 1) / 2
+	// compare 'pairs' with the threshold scaled by the number of triplets - 1
+	double max_pairs = threshold * (win_len - 3);
+	std::size_t num_masked = 0;
+	masked.resize(len - win_len + 1, false);
+
+	auto triplet = [seq](std::size_t pos) {
+		return ((seq[pos] & 3) << 4) | ((seq[pos + 1] & 3) << 2) | (seq[pos + 2] & 3);
+	};
+
+	// the first window
+	for (std::size_t i = 0; i + 2 < win_len; ++i)
+		pairs += counts[triplet(i)]++;
+
+	for (std::size_t pos = 0;; ++pos)
+	{
+		if (pairs > max_pairs)
+		{
+			masked[pos] = true;
+			++num_masked;
+		}
+		if (pos + win_len == len)
+			break;
+		// slide: drop the first triplet, add the one ending at the new last position
+		pairs -= --counts[triplet(pos)];
+		pairs += counts[triplet(pos + win_len - 2)]++;
+	}
+	return num_masked;
+} // ~dust_mask
+
+// ~dust.cpp
@@ -0,0 +1,206 @@
+/**
+ * FILE: estimate.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <cmath>
+#include <random>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "common.hpp"
+#include "options.hpp"
+#include "estimate.hpp"
+#include "read.hpp"
+#include "reader.hpp"
+#include "readstats.hpp"
+#include "refstats.hpp"
+#include "index.hpp"
+#include "references.hpp"
+#include "readsqueue.hpp"
+#include "processor.hpp"
+#include "alignment.hpp"
+#include "output.hpp"
+#include "ThreadPool.hpp"
+#include "aio.hpp"
+
+// forward
+void alignmentCb(Runopts & opts, Index & index, References & refs, Output & output, Readstats & readstats,
+	Refstats & refstats, Read & read, AlignScratch & scratch, bool isLastStrand); // paralleltraversal.cpp
+
+namespace {
+	const double Z95 = 1.96; // 95% confidence
+	const std::size_t FIRST_BATCH = 1000; // reads in the first batch. Doubled for every next batch
+
+	// Wilson score interval of a binomial proportion
+	std::pair<double, double> wilson(uint64_t hits, uint64_t num)
+	{
+		if (num == 0) return { 0, 1 };
+		double p = static_cast<double>(hits) / num;
+		double z2n = Z95 * Z95 / num;
+		double center = (p + z2n / 2) / (1 + z2n);
+		double half = Z95 * std::sqrt(p * (1 - p) / num + z2n / (4 * num)) / (1 + z2n);
+		return { std::max(0.0, center - half), std::min(1.0, center + half) };
+	}
+}
+
+void estimate(Runopts & opts, Readstats & readstats, Output & output, Index & index)
+{
+	std::stringstream ss;
+	ss << "\n" << STAMP << "==== Starting estimation ====\n\n";
+	std::cout << ss.str();
+
+	int numProcThread = opts.num_proc_thread > 0 ? opts.num_proc_thread : std::thread::hardware_concurrency();
+
+	// the sample was taken by the reads statistics pass (Readstats::calculate)
+	auto & sample = readstats.sample;
+	std::mt19937_64 rng(ESTIMATE_SEED);
+	std::shuffle(sample.begin(), sample.end(), rng); // any prefix is a uniform sample too
+	auto starts = std::chrono::high_resolution_clock::now();
+
+	ThreadPool tpool(numProcThread + 2); // feeder + processors + collector
+	ReadsQueue readQueue("read_queue", opts.queue_size_max, 1);
+	ReadsQueue writeQueue("write_queue", opts.queue_size_max, numProcThread);
+	Refstats refstats(opts, readstats);
+	References refs;
+
+	// the counters are collected on the sample only
+	std::fill(readstats.reads_matched_per_db.begin(), readstats.reads_matched_per_db.end(), 0);
+	readstats.total_reads_aligned = 0;
+
+	uint64_t num_searched = 0; // sampled reads searched through all the index parts
+	double width = 1; // widest confidence interval
+	bool is_loaded = false;
+	uint16_t loaded_num = 0;
+	uint32_t loaded_part = 0;
+	std::vector<Read> batch;
+	std::vector<Read> done;
+
+	for (std::size_t next = 0, batch_size = FIRST_BATCH; next < sample.size() && width > opts.estimate_width; batch_size *= 2)
+	{
+		auto end = std::min(sample.size(), next + batch_size);
+		batch.clear();
+		for (; next < end; ++next)
+		{
+			auto & sampled = sample[next];
+			batch.emplace_back();
+			auto & read = batch.back();
+			read.format = sampled.format;
+			read.header = std::move(sampled.header);
+			read.sequence = std::move(sampled.sequence);
+			read.quality = std::move(sampled.quality);
+			read.isEmpty = false;
+			read.read_num = sampled.read_num;
+			read.readfile_idx = sampled.readfile_idx;
+			read.generate_id();
+			read.init(opts);
+		}
+		num_searched += batch.size();
+
+		for (uint16_t index_num = 0; index_num < (uint16_t)opts.indexfiles.size(); ++index_num)
+		{
+			for (uint32_t idx_part = 0; idx_part < refstats.num_index_parts[index_num]; ++idx_part)
+			{
+				// with a single index part it is loaded once
+				if (!is_loaded || loaded_num != index_num || loaded_part != idx_part)
+				{
+					index.clear();
+					refs.clear();
+					index.load(index_num, idx_part, opts, refstats);
+					refs.load(index_num, idx_part, opts, refstats);
+					is_loaded = true;
+					loaded_num = index_num;
+					loaded_part = idx_part;
+				}
+
+				readQueue.reset(1);
+				writeQueue.reset(numProcThread);
+				done.clear();
+
+				tpool.addJob([&readQueue, &batch]() {
+					for (auto & read : batch)
+						readQueue.push(read);
+					readQueue.decrPushers();
+					readQueue.notify();
+				});
+				for (int i = 0; i < numProcThread; ++i)
+					tpool.addJob(Processor("proc_" + std::to_string(i), readQueue, writeQueue, opts, index, refs, output, readstats, refstats, alignmentCb));
+				tpool.addJob([&writeQueue, &done]() {
+					for (bool is_done = false;;)
+					{
+						Read read = writeQueue.pop();
+						if (read.isEmpty)
+						{
+							if (is_done) break; // drained after the last pusher finished
+							is_done = writeQueue.getPushers() == 0;
+							continue;
+						}
+						done.push_back(read);
+					}
+				});
+				tpool.waitAll();
+				batch.swap(done); // the reads shorter than the seed were dropped by the processors i.e. not matching
+			} // ~for(idx_part)
+		} // ~for(index_num)
+
+		auto ci = wilson(readstats.total_reads_aligned.load(), num_searched);
+		width = ci.second - ci.first;
+		ss.str("");
+		ss << STAMP << "Searched " << num_searched << " sampled reads. Matching: " << std::setprecision(2) << std::fixed
+			<< 100.0 * readstats.total_reads_aligned.load() / num_searched << "% [" << 100 * ci.first << ", " << 100 * ci.second << "]";
+		for (uint16_t index_num = 0; index_num < (uint16_t)opts.indexfiles.size(); ++index_num)
+		{
+			ci = wilson(readstats.reads_matched_per_db[index_num], num_searched);
+			width = std::max(width, ci.second - ci.first);
+			ss << " db" << index_num + 1 << ": " << 100.0 * readstats.reads_matched_per_db[index_num] / num_searched
+				<< "% [" << 100 * ci.first << ", " << 100 * ci.second << "]";
+		}
+		ss << " CI width: " << std::setprecision(4) << width << std::endl;
+		std::cout << ss.str();
+	} // ~for(batch)
+
+	index.clear();
+	refs.clear();
+	std::vector<SampledRead>().swap(sample);
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - starts;
+	ss.str("");
+	ss << STAMP << "Searched " << num_searched << " of " << readstats.all_reads_count << " reads in " << std::setprecision(2) << std::fixed << elapsed.count() << " sec" << std::endl;
+	std::cout << ss.str();
+
+	// extrapolate to all the reads
+	uint64_t all_reads = readstats.all_reads_count > 0 ? readstats.all_reads_count : num_searched;
+	auto extrapolate = [&](uint64_t hits) { return static_cast<uint64_t>(std::llround(static_cast<double>(hits) * all_reads / std::max<uint64_t>(num_searched, 1))); };
+	auto ci = wilson(readstats.total_reads_aligned.load(), num_searched);
+	output.summary.est_sampled = num_searched;
+	output.summary.mapped_ci = std::make_pair(float(100 * ci.first), float(100 * ci.second));
+	for (uint16_t index_num = 0; index_num < (uint16_t)opts.indexfiles.size(); ++index_num)
+	{
+		ci = wilson(readstats.reads_matched_per_db[index_num], num_searched);
+		output.summary.db_ci.emplace_back(std::make_pair(float(100 * ci.first), float(100 * ci.second)));
+		readstats.reads_matched_per_db[index_num] = extrapolate(readstats.reads_matched_per_db[index_num]);
+	}
+	readstats.total_reads_aligned = extrapolate(readstats.total_reads_aligned.load());
+	readstats.all_reads_count = all_reads;
+
+	output.writeLog(opts, refstats, readstats); // readstats are not stored to KVDB: the values are estimates
+
+	ss.str("");
+	ss << "\n" << STAMP << "==== Done estimation ====\n\n";
+	std::cout << ss.str();
+} // ~estimate
+
+std::size_t estimate_sample_size(double width)
+{
+	// any fraction gets the target width with (z / width)^2 reads
+	return static_cast<std::size_t>(std::ceil(Z95 * Z95 / (width * width)));
+}
+
+// ~estimate.cpp
@@ -10,19 +10,58 @@
 #include <string>
 #include <cassert>
 #include <algorithm>
+#include <thread>
 
 #include "gzip.hpp"
 
 
-Gzip::Gzip(bool gzipped) 
+Gzip::Gzip(Runopts::ZIP_FORMAT zip) 
 	: 
-	gzipped(gzipped), 
+	zip(zip),
+	gzipped(zip == Runopts::ZIP_GZIP), 
 	line_start(0)
 { 
 	if (gzipped) 
 		init(); 
+#ifndef HAVE_ZSTD
+	if (zip == Runopts::ZIP_ZSTD)
+	{
+		ERR("The Reads file is zstd compressed, but this build has no zstd support (HAVE_ZSTD)."
+			" Please decompress the file or use a build with zstd.");
+		exit(EXIT_FAILURE);
+	}
+#endif
+}
+
+bool Gzip::is_zstd_supported()
+{
+#ifdef HAVE_ZSTD
+	return true;
+#else
+	return false;
+#endif
 }
 
+/*
+ * detect the compression by the magic number at the start of the stream
+ */
+Runopts::ZIP_FORMAT Gzip::detect(std::istream & ifs)
+{
+	unsigned char magic[4] = { 0 };
+	ifs.read(reinterpret_cast<char*>(magic), sizeof(magic));
+	auto num = ifs.gcount();
+	ifs.clear();
+	ifs.seekg(0);
+
+	if (num >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+		return Runopts::ZIP_GZIP;
+	// zstd frame 0xFD2FB528 or skippable frame 0x184D2A5? (little endian)
+	if (num == 4 && ((magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+		|| ((magic[0] & 0xf0) == 0x50 && magic[1] == 0x2a && magic[2] == 0x4d && magic[3] == 0x18)))
+		return Runopts::ZIP_ZSTD;
+	return Runopts::ZIP_NONE;
+} // ~Gzip::detect
+
 
 //Gzip::~Gzip() {
 //	line_start = 0;
@@ -65,13 +104,18 @@ void Gzip::init()
  *       std::getline doesn't return error if the stream is not 
  *       readable/closed. It returns the same input it was passed.
  */
-int Gzip::getline(std::ifstream & ifs, std::string & line)
+int Gzip::getline(std::istream & ifs, std::string & line)
 {
 	char* line_end = 0;
 	int ret = RL_OK;
 
 	line.clear();
 
+#ifdef HAVE_ZSTD
+	if (zip == Runopts::ZIP_ZSTD)
+		return zstd_getline(ifs, line);
+#endif
+
 	if (gzipped)
 	{
 		bool line_ready = false;
@@ -136,7 +180,7 @@ int Gzip::getline(std::ifstream & ifs, std::string & line)
 /*
  * Called from getline
  */
-int Gzip::inflatez(std::ifstream & ifs)
+int Gzip::inflatez(std::istream & ifs)
 {
 	int ret;
 	std::stringstream ss;
@@ -203,4 +247,188 @@ int Gzip::inflatez(std::ifstream & ifs)
 	} // for(;;)
 
 	return ret;// == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
-} // ~Gzip::inflatez
\ No newline at end of file
+} // ~Gzip::inflatez
+#ifdef HAVE_ZSTD
+/*
+ * zstd: next line from the decompressed text. Refills the text as needed
+ */
+int Gzip::zstd_getline(std::istream & ifs, std::string & line)
+{
+	for (;;)
+	{
+		if (zs_pos < zs_text.size())
+		{
+			auto line_end = zs_text.find('\n', zs_pos);
+			if (line_end != std::string::npos)
+			{
+				line.append(zs_text, zs_pos, line_end - zs_pos);
+				zs_pos = line_end + 1; // skip '\n'
+				return RL_OK;
+			}
+			line.append(zs_text, zs_pos, std::string::npos); // the line continues in the next portion
+		}
+		zs_text.clear();
+		zs_pos = 0;
+
+		int ret = zstd_fill(ifs);
+		if (ret == RL_ERR)
+			return RL_ERR;
+		if (ret == RL_END)
+			return line.empty() ? RL_END : RL_OK; // the last line may have no '\n'
+	}
+} // ~Gzip::zstd_getline
+
+/*
+ * zstd: read the next chunk of the file. The decoded input is dropped first
+ */
+bool Gzip::zstd_read(std::istream & ifs)
+{
+	zs_in.erase(zs_in.begin(), zs_in.begin() + zs_in_pos);
+	zs_in_pos = 0;
+	if (zs_is_eof)
+		return false;
+
+	auto size = zs_in.size();
+	zs_in.resize(size + ZSTD_IN_SIZE);
+	ifs.read(zs_in.data() + size, ZSTD_IN_SIZE);
+	auto num = static_cast<std::size_t>(ifs.gcount());
+	zs_in.resize(size + num);
+	if (num < ZSTD_IN_SIZE)
+		zs_is_eof = true;
+	return num > 0;
+} // ~Gzip::zstd_read
+
+/*
+ * zstd: decode the next portion of the input into 'zs_text'
+ *
+ * @return RL_OK | RL_END (no more data) | RL_ERR
+ */
+int Gzip::zstd_fill(std::istream & ifs)
+{
+	if (!zs_is_init)
+	{
+		zs_is_init = true;
+		zstd_read(ifs);
+		// the first frame is complete in the first chunk - a file of small frames, decode them in parallel
+		zs_is_frames = !ZSTD_isError(ZSTD_findFrameCompressedSize(zs_in.data(), zs_in.size()));
+		if (!zs_is_frames)
+		{
+			zds.reset(ZSTD_createDStream(), ZSTD_freeDStream);
+			ZSTD_initDStream(zds.get());
+		}
+	}
+
+	if (!zs_is_frames)
+	{
+		// single frame: streaming decompression
+		zs_text.resize(ZSTD_DStreamOutSize());
+		for (;;)
+		{
+			if (zs_in_pos == zs_in.size() && !zstd_read(ifs))
+			{
+				if (zs_is_frame_end)
+					return RL_END;
+				ERR("zstd decompression failed: truncated frame at the end of the file");
+				return RL_ERR;
+			}
+
+			ZSTD_inBuffer in = { zs_in.data(), zs_in.size(), zs_in_pos };
+			ZSTD_outBuffer out = { &zs_text[0], zs_text.size(), 0 };
+			auto ret = ZSTD_decompressStream(zds.get(), &out, &in);
+			if (ZSTD_isError(ret))
+			{
+				ERR(std::string("zstd decompression failed: ") + ZSTD_getErrorName(ret));
+				return RL_ERR;
+			}
+			zs_in_pos = in.pos;
+			zs_is_frame_end = ret == 0;
+			if (out.pos > 0)
+			{
+				zs_text.resize(out.pos);
+				return RL_OK;
+			}
+		}
+	}
+
+	// multiple frames: collect the complete frames, at least one per thread unless at the end of the file
+	std::vector<std::pair<std::size_t, std::size_t>> frames; // offset into 'zs_in', compressed size
+	for (;;)
+	{
+		frames.clear();
+		for (auto pos = zs_in_pos; pos < zs_in.size(); )
+		{
+			auto frame_size = ZSTD_findFrameCompressedSize(zs_in.data() + pos, zs_in.size() - pos);
+			if (ZSTD_isError(frame_size))
+				break; // incomplete frame
+			frames.emplace_back(pos, frame_size);
+			pos += frame_size;
+		}
+		if (frames.size() >= ZSTD_THREADS || zs_is_eof)
+			break;
+		zstd_read(ifs); // invalidates the offsets - collect again
+	}
+
+	if (frames.empty())
+	{
+		if (zs_in_pos == zs_in.size())
+			return RL_END;
+		ERR("zstd decompression failed: truncated or corrupted frame at the end of the file");
+		return RL_ERR;
+	}
+
+	// decode the frames, each thread every num_threads-th frame
+	std::vector<std::string> texts(frames.size());
+	std::vector<std::size_t> errors(frames.size(), 0);
+	auto decode = [this, &frames, &texts, &errors](std::size_t first, std::size_t step) {
+		std::unique_ptr<ZSTD_DCtx, std::size_t(*)(ZSTD_DCtx*)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+		for (auto i = first; i < frames.size(); i += step)
+		{
+			const char *src = zs_in.data() + frames[i].first;
+			auto content_size = ZSTD_getFrameContentSize(src, frames[i].second);
+			if (content_size == ZSTD_CONTENTSIZE_ERROR)
+			{
+				errors[i] = content_size;
+				continue;
+			}
+			if (content_size != ZSTD_CONTENTSIZE_UNKNOWN) // 0 for a skippable frame e.g. the seek table of the seekable format
+			{
+				texts[i].resize(content_size);
+				auto ret = ZSTD_decompressDCtx(dctx.get(), &texts[i][0], texts[i].size(), src, frames[i].second);
+				if (ZSTD_isError(ret)) errors[i] = ret;
+				continue;
+			}
+			// the content size is not in the frame header - stream it
+			ZSTD_DCtx_reset(dctx.get(), ZSTD_reset_session_only);
+			ZSTD_inBuffer in = { src, frames[i].second, 0 };
+			std::string chunk(ZSTD_DStreamOutSize(), 0);
+			while (in.pos < in.size)
+			{
+				ZSTD_outBuffer out = { &chunk[0], chunk.size(), 0 };
+				auto ret = ZSTD_decompressStream(dctx.get(), &out, &in);
+				if (ZSTD_isError(ret)) { errors[i] = ret; break; }
+				texts[i].append(chunk, 0, out.pos);
+			}
+		}
+	};
+
+	std::size_t num_threads = std::min<std::size_t>({ ZSTD_THREADS, frames.size(), std::max(1U, std::thread::hardware_concurrency()) });
+	std::vector<std::thread> threads;
+	for (std::size_t i = 1; i < num_threads; ++i)
+		threads.emplace_back(decode, i, num_threads);
+	decode(0, num_threads);
+	for (auto & thread : threads)
+		thread.join();
+
+	for (std::size_t i = 0; i < frames.size(); ++i)
+	{
+		if (errors[i] != 0)
+		{
+			ERR(std::string("zstd decompression failed: ") + ZSTD_getErrorName(errors[i]));
+			return RL_ERR;
+		}
+		zs_text += texts[i];
+	}
+	zs_in_pos = frames.back().first + frames.back().second;
+	return RL_OK;
+} // ~Gzip::zstd_fill
+#endif // HAVE_ZSTD
@@ -51,6 +51,9 @@
 #include "paralleltraversal.hpp"
 #include "references.hpp"
 #include "refstats.hpp"
+#include "trace.hpp"
+#include "traverse_bursttrie.hpp"
+#include "aio.hpp"
 
 // forward
 std::string string_hash(const std::string& val); // util.cpp
@@ -118,6 +121,7 @@ Index::Index(Runopts & opts)
 		}
 		else
 		{
+			TraceSpan span("index_build", "index");
 			build_index(opts);
 		}
 	}
@@ -127,7 +131,7 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 {
 	// STEP 1: load the kmer 'count' variables (dbname.kmer.dat)
 	std::string idxfile = opts.indexfiles[idx_num].second + ".kmer_" + std::to_string(idx_part) + ".dat";
-	std::ifstream inkmer(idxfile, std::ios::in | std::ios::binary);
+	AioIfstream inkmer(idxfile, std::ios::in | std::ios::binary);
 
 	if (!inkmer.good())
 	{
@@ -138,6 +142,8 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 	}
 
 	uint32_t limit = 1 << refstats.lnwin[idx_num];
+	lookup_tbl.reserve(limit);
+	Arena::advise(lookup_tbl.data(), sizeof(kmer) * limit);
 
 	for (uint32_t i = 0; i < limit && !inkmer.eof(); i++)
 	{
@@ -148,7 +154,7 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 
 	// STEP 2: load the burst tries ( bursttrief.dat, bursttrier.dat )
 	std::string btriefile = opts.indexfiles[idx_num].second + ".bursttrie_" + std::to_string(idx_part) + ".dat";
-	std::ifstream btrie(btriefile, std::ios::in | std::ios::binary);
+	AioIfstream btrie(btriefile, std::ios::in | std::ios::binary);
 	if (!btrie.good())
 	{
 		std::stringstream ss;
@@ -172,14 +178,8 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 		// allocate contiguous memory for both mini-burst tries if they exist
 		if (lookup_tbl[i].count != 0)
 		{
-			dst = new char[(sizeoftries[0] + sizeoftries[1])]();
-			if (dst == NULL)
-			{
-				std::stringstream ss;
-				ss << STAMP << "Failed to allocate memory for mini-burst tries";
-				ERR(ss.str())
-				exit(EXIT_FAILURE);
-			}
+			dst = static_cast<char*>(arena.alloc(sizeoftries[0] + sizeoftries[1], alignof(NodeElement))); // zero filled
+			arena_bytes += sizeoftries[0] + sizeoftries[1];
 			// load 2 burst tries per 9-mer
 			for (int j = 0; j < 2; j++)
 			{
@@ -250,20 +250,9 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 								uint32_t sizeofbucket = 0;
 								// read the bucket info
 								btrie.read(reinterpret_cast<char*>(&sizeofbucket), sizeof(uint32_t));
-
-								char* bucket = new char[sizeofbucket]();
-								if (bucket == NULL)
-								{
-									std::stringstream ss;
-									ss << STAMP << "Failed to allocate memory for allocate bucket";
-									fprintf(stderr, "\n  %sERROR%s:  (paralleltraversal.cpp)\n", RED, COLOFF);
-									exit(EXIT_FAILURE);
-								}
-								btrie.read(reinterpret_cast<char*>(bucket), sizeofbucket);
-								// copy the bucket into the burst trie array
-								memcpy((void*)dst, (void*)bucket, sizeofbucket);
-								delete[] bucket;
-								bucket = NULL;
+								bucket_bytes += sizeofbucket;
+								// read the bucket straight into the burst trie array
+								btrie.read(dst, sizeofbucket);
 								// assign pointers from trie node to the bucket
 								node->flag = flag;
 								node->nodetype.bucket = dst;
@@ -302,7 +291,7 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 
 	// STEP 3: load the position reference tables (pos.dat)
 	std::string posfile = opts.indexfiles[idx_num].second + ".pos_" + std::to_string(idx_part) + ".dat";
-	std::ifstream inreff(posfile, std::ios::in | std::ios::binary);
+	AioIfstream inreff(posfile, std::ios::in | std::ios::binary);
 
 	if (!inreff.good())
 	{
@@ -313,6 +302,7 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 	uint32_t size = 0;
 	inreff.read(reinterpret_cast<char*>(&number_elements), sizeof(uint32_t));
 	positions_tbl.reserve(number_elements); // = new kmer_origin[number_elements]();
+	Arena::advise(positions_tbl.data(), sizeof(kmer_origin) * number_elements);
 
 	if (positions_tbl.capacity() == 0)
 	{
@@ -327,47 +317,36 @@ void Index::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats &
 		inreff.read(reinterpret_cast<char*>(&size), sizeof(uint32_t));
 		positions_tbl[i].size = size;
 		/* the sequence seq_pos array */
-		positions_tbl[i].arr = new seq_pos[size]();
-		if (positions_tbl[i].arr == NULL)
-		{
-			fprintf(stderr, "  ERROR: could not allocate memory for positions_tbl (paralleltraversal.cpp)\n");
-			exit(EXIT_FAILURE);
-		}
+		positions_tbl[i].arr = arena.alloc_array<seq_pos>(size);
+		positions_bytes += sizeof(seq_pos) * size;
 		inreff.read(reinterpret_cast<char*>(positions_tbl[i].arr), sizeof(seq_pos)*size);
 	}
 
 	inreff.close();
 	index_num = idx_num;
 	part = idx_part;
+	kernels = select_seed_kernels(refstats.partialwin[idx_num]);
+
+	// OPT_FULL_SEARCH collects all the matches of a window, not just the exact one
+	if (!opts.is_full_search)
+		seed_hash.build(lookup_tbl, number_elements, refstats.partialwin[idx_num], opts.minoccur);
+
+	// STEP 4: the reference clusters (OPT_CLUSTER_ID). Absent if the index part was not clustered
+	clusters.load(opts.indexfiles[idx_num].second + ".clust_" + std::to_string(idx_part) + ".dat",
+		refstats.index_parts_stats_vec[idx_num][idx_part].numseq_part);
 } // ~Index::load
 
 void Index::clear()
 {
-	// lookup_tbl
-	for (int i = 0; i < lookup_tbl.size(); i++)
-	{
-		if (lookup_tbl[i].trie_F != NULL)
-		{
-			delete[] lookup_tbl[i].trie_F;
-			lookup_tbl[i].trie_F = NULL;
-			lookup_tbl[i].trie_R = NULL;
-		}
-		if (lookup_tbl[i].trie_R != NULL)
-		{
-			delete[] lookup_tbl[i].trie_R;
-			lookup_tbl[i].trie_R = NULL;
-		}
-	}
+	// the tries and the seq_pos arrays are released with the arena
 	lookup_tbl.clear();
-
-	// positions_tbl
-	for (int i = 0; i < positions_tbl.size(); i++)
-	{
-		if (positions_tbl[i].arr != NULL)
-		{
-			delete[] positions_tbl[i].arr;
-			positions_tbl[i].arr = NULL;
-		}
-	}
 	positions_tbl.clear();
+	arena.clear();
+	kernels = nullptr;
+	seed_hash.clear();
+	clusters.clear();
+
+	arena_bytes = 0;
+	bucket_bytes = 0;
+	positions_bytes = 0;
 } // ~Index::clear
\ No newline at end of file
@@ -52,6 +52,9 @@
 #include "cmph.h"
 #include <sys/stat.h> //for creating tmp dir
 #include "options.hpp"
+#include "references.hpp"
+#include "dust.hpp"
+#include "refclusters.hpp"
 
 #if defined(_WIN32)
 #include <Winsock.h>
@@ -111,6 +114,9 @@ uint32_t partialwin_gv = 0; // lnwin_gv / 2
 uint32_t mask32 = 0;
 uint64_t mask64 = 0;
 
+/* spaced seed (OPT_SEED_MASK): positions of the (L+1)-mer nt relative to the seed start. Empty - contiguous seed */
+std::vector<uint32_t> seed_offsets_gv;
+
 uint32_t total_num_trie_nodes = 0;
 uint32_t size_of_all_buckets = 0;
 uint32_t sizeoftrie = 0;
@@ -343,6 +349,35 @@ inline void add_kmer_to_table(kmer_origin* positions_tbl,
 	positions_tbl->size++;
 }//~add_kmer_to_table
 
+/*
+ * (L+1)-mer of a spaced seed (OPT_SEED_MASK): the nt at the '1' positions of the mask followed
+ * by the nt just after the mask. The tries, the keys and the positions are built from it exactly
+ * as from a contiguous (L+1)-mer starting at the same position.
+ */
+struct spaced_kmer
+{
+	unsigned char fwd[32]; // the (L+1)-mer
+	unsigned char rev[32]; // reversed
+	uint32_t key_f = 0; // L/2-mer prefix
+	uint32_t key_r = 0; // L/2-mer suffix
+	unsigned long long key = 0; // the (L+1)-mer
+};
+
+inline void get_spaced_kmer(const unsigned char* seq, uint32_t pos, spaced_kmer &sk)
+{
+	sk.key_f = 0;
+	sk.key_r = 0;
+	sk.key = 0;
+	for (uint32_t j = 0; j < pread_gv; j++)
+	{
+		sk.fwd[j] = seq[pos + seed_offsets_gv[j]];
+		sk.rev[pread_gv - 1 - j] = sk.fwd[j];
+		(sk.key <<= 2) |= sk.fwd[j];
+		if (j < partialwin_gv) (sk.key_f <<= 2) |= sk.fwd[j];
+		else if (j > partialwin_gv) (sk.key_r <<= 2) |= sk.fwd[j];
+	}
+}//~get_spaced_kmer
+
 
 /*
  *
@@ -1137,6 +1172,15 @@ int build_index(Runopts &opts)
 	mask32 = (1 << opts.seed_win_len) - 1;
 	mask64 = (2ULL << ((pread_gv * 2) - 1)) - 1;
 
+	seed_offsets_gv.clear();
+	for (uint32_t j = 0; j < opts.seed_mask.size(); j++)
+		if (opts.seed_mask[j] == '1') seed_offsets_gv.push_back(j);
+	if (seed_offsets_gv.size() > 0)
+		seed_offsets_gv.push_back(static_cast<uint32_t>(opts.seed_mask.size())); // the (L+1)th nt
+	// nt spanned by an (L+1)-mer
+	uint32_t seed_span = seed_offsets_gv.size() > 0 ? seed_offsets_gv.back() + 1 : pread_gv;
+	spaced_kmer sk;
+
 	// temp file for storing keys of all s-mer (19-mer) words of the reference sequences. 
 	// Required for CMPH to build minimal perfect hash functions
 	std::string keys_file;
@@ -1145,6 +1189,8 @@ int build_index(Runopts &opts)
 	DBG(opts.is_verbose, "\n  Parameters summary: \n");
 	DBG(opts.is_verbose, "    K-mer size: %d\n", opts.seed_win_len + 1);
 	DBG(opts.is_verbose, "    K-mer interval: %d\n", opts.interval);
+	if (seed_offsets_gv.size() > 0)
+		DBG(opts.is_verbose, "    Spaced seed mask: %s\n", opts.seed_mask.data());
 
 	if (opts.max_pos == 0)
 		DBG(opts.is_verbose, "    Maximum positions to store per unique K-mer: all\n");
@@ -1342,6 +1388,12 @@ int build_index(Runopts &opts)
 			// bool vector to keep track which L/2-mers have been counted for by the forward sliding L/2-mer window
 			std::vector<bool> incremented_by_forward((1 << opts.seed_win_len));
 
+			std::vector<bool> dust_masked; // low complexity (L+1)-mers of the current sequence (OPT_DUST)
+			uint64_t num_dust_masked = 0;
+
+			// the references of the part clustered as they are read (OPT_CLUSTER_ID)
+			RefClusters clusters(opts.cluster_id);
+
 			// total size of index so far in bytes
 			index_size = 0;
 
@@ -1441,6 +1493,9 @@ int build_index(Runopts &opts)
 					numseq_part++;
 				}
 
+				// a cluster member (OPT_CLUSTER_ID) is not indexed, it is aligned with its centroid
+				bool is_member = opts.cluster_id > 0 && clusters.add(myseq, len) != numseq_part - 1;
+
 				// create a reverse sequence using the forward
 				unsigned char* ptr = &myseq[len - 1];
 
@@ -1471,76 +1526,101 @@ int build_index(Runopts &opts)
 				// initialize the 19-mer
 				for (uint32_t j = 0; j < pread_gv; j++) (kmer_key <<= 2) |= (int)*kmer_key_ptr++;
 
-				uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval; //TESTING
+				uint32_t numwin = is_member || len < seed_span ? 0 : (len - seed_span + opts.interval) / opts.interval; //TESTING
 				uint32_t index_pos = 0;
 
+				// low complexity (L+1)-mers (OPT_DUST)
+				if (opts.dust > 0)
+					dust_mask(reinterpret_cast<const char*>(myseq), len, seed_span, opts.dust, dust_masked);
+
 				// for all 19-mers on the sequence
 				for (uint32_t j = 0; j < numwin; j++) //TESTING
 				{
-					lookup_table[kmer_key_short_f].count++;
-					incremented_by_forward[kmer_key_short_f] = true;
-					// increment 9-mer count only if it wasn't already
-					// incremented by kmer_key_short_f before
-					if (!incremented_by_forward[kmer_key_short_r]) lookup_table[kmer_key_short_r].count++;
+					// spaced seed: the (L+1)-mer is gathered at every position instead of sliding
+					if (seed_offsets_gv.size() > 0)
+					{
+						get_spaced_kmer(myseq, index_pos, sk);
+						kmer_key_short_f = sk.key_f;
+						kmer_key_short_r = sk.key_r;
+						kmer_key_short_f_p = &sk.fwd[partialwin_gv];
+						kmer_key_short_r_rp = &sk.rev[pread_gv - 1 - partialwin_gv];
+						kmer_key = sk.key;
+					}
 
-					// ****** add the forward 19-mer
+					// low complexity (L+1)-mer (OPT_DUST) is not indexed
+					if (opts.dust > 0 && dust_masked[index_pos])
+					{
+						++num_dust_masked;
+					}
+					else
+					{
+						lookup_table[kmer_key_short_f].count++;
+						incremented_by_forward[kmer_key_short_f] = true;
+						// increment 9-mer count only if it wasn't already
+						// incremented by kmer_key_short_f before
+						if (!incremented_by_forward[kmer_key_short_r]) lookup_table[kmer_key_short_r].count++;
 
-					// new position for 18-mer in positions_tbl
-					bool new_position = true;
+						// ****** add the forward 19-mer
 
-					// forward 19-mer does not exist in the burst trie (duplicates not allowed)
-					if (lookup_table[kmer_key_short_f].trie_F == NULL ||
-						(lookup_table[kmer_key_short_f].trie_F != NULL && 
-						!search_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, new_position)))
-					{
-						// create a trie node if it doesn't exist
-						if (lookup_table[kmer_key_short_f].trie_F == NULL)
+						// new position for 18-mer in positions_tbl
+						bool new_position = true;
+
+						// forward 19-mer does not exist in the burst trie (duplicates not allowed)
+						if (lookup_table[kmer_key_short_f].trie_F == NULL ||
+							(lookup_table[kmer_key_short_f].trie_F != NULL && 
+							!search_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, new_position)))
 						{
-							lookup_table[kmer_key_short_f].trie_F = (NodeElement*)malloc(4 * sizeof(NodeElement));
+							// create a trie node if it doesn't exist
 							if (lookup_table[kmer_key_short_f].trie_F == NULL)
 							{
-								std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
-								exit(EXIT_FAILURE);
+								lookup_table[kmer_key_short_f].trie_F = (NodeElement*)malloc(4 * sizeof(NodeElement));
+								if (lookup_table[kmer_key_short_f].trie_F == NULL)
+								{
+									std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
+									exit(EXIT_FAILURE);
+								}
+								memset(lookup_table[kmer_key_short_f].trie_F, 0, 4 * sizeof(NodeElement));
 							}
-							memset(lookup_table[kmer_key_short_f].trie_F, 0, 4 * sizeof(NodeElement));
-						}
 
-						insert_prefix(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p);
-					}
+							insert_prefix(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p);
+						}
 
-					// 18-mer doesn't exist in the burst trie, add it to keys file
-					if (new_position)
-					{
-						// increment number of unique 18-mers
-						number_elements++;
-						fprintf(keys, "%llu\n", (kmer_key >> 2));
-					}
+						// 18-mer doesn't exist in the burst trie, add it to keys file
+						if (new_position)
+						{
+							// increment number of unique 18-mers
+							number_elements++;
+							fprintf(keys, "%llu\n", (kmer_key >> 2));
+						}
 
-					// ****** add the reverse 19-mer
-					new_position = true;
+						// ****** add the reverse 19-mer
+						new_position = true;
 
-					// reverse 19-mer does not exist in the burst trie
-					if (lookup_table[kmer_key_short_r].trie_R == NULL ||
-						((lookup_table[kmer_key_short_r].trie_R != NULL) && 
-						!search_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, new_position)))
-					{
-						// create a trie node if it doesn't exist
-						if (lookup_table[kmer_key_short_r].trie_R == NULL)
+						// reverse 19-mer does not exist in the burst trie
+						if (lookup_table[kmer_key_short_r].trie_R == NULL ||
+							((lookup_table[kmer_key_short_r].trie_R != NULL) && 
+							!search_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, new_position)))
 						{
-							lookup_table[kmer_key_short_r].trie_R = (NodeElement*)malloc(4 * sizeof(NodeElement));
+							// create a trie node if it doesn't exist
 							if (lookup_table[kmer_key_short_r].trie_R == NULL)
 							{
-								std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
-								exit(EXIT_FAILURE);
+								lookup_table[kmer_key_short_r].trie_R = (NodeElement*)malloc(4 * sizeof(NodeElement));
+								if (lookup_table[kmer_key_short_r].trie_R == NULL)
+								{
+									std::cerr << RED << "  ERROR" << COLOFF << ": could not allocate memory for trie_node in indexdb.cpp" << std::endl;
+									exit(EXIT_FAILURE);
+								}
+								memset(lookup_table[kmer_key_short_r].trie_R, 0, 4 * sizeof(NodeElement));
 							}
-							memset(lookup_table[kmer_key_short_r].trie_R, 0, 4 * sizeof(NodeElement));
-						}
 
-						insert_prefix(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp);
+							insert_prefix(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp);
+						}
 					}
 
 					// shift 19-mer window and both 9-mers
-					if (j != numwin - 1)
+					if (j != numwin - 1 && seed_offsets_gv.size() > 0)
+						index_pos += opts.interval;
+					else if (j != numwin - 1)
 					{
 						for (uint32_t shift = 0; shift < opts.interval; shift++)
 						{
@@ -1574,6 +1654,11 @@ int build_index(Runopts &opts)
 			rewind(keys);
 
 			DBG(opts.is_verbose, " done  [%f sec]\n", (end - start));
+			if (opts.dust > 0)
+				DBG(opts.is_verbose, "    low complexity (L+1)-mers not indexed (%s %.2f) = %llu\n", OPT_DUST.data(), opts.dust, (unsigned long long)num_dust_masked);
+			if (opts.cluster_id > 0)
+				DBG(opts.is_verbose, "    cluster centroids indexed (%s %.2f) = %zu of %zu references\n", OPT_CLUSTER_ID.data(), opts.cluster_id,
+					clusters.num_centroids(), clusters.size());
 
 			// 4. build MPHF on the unique 18-mers
 			DBG(opts.is_verbose, "    (2/3) building CMPH hash ..");
@@ -1716,29 +1801,51 @@ int build_index(Runopts &opts)
 				for (uint32_t j = 0; j < pread_gv; j++)
 					(kmer_key <<= 2) |= (int)*kmer_key_ptr++;
 
-				uint32_t numwin = (len - pread_gv + opts.interval) / opts.interval; //TESTING
+				// cluster member (OPT_CLUSTER_ID) - not in the tries (see the 1st pass)
+				uint32_t numwin = clusters.is_member(i) || len < seed_span ? 0 : (len - seed_span + opts.interval) / opts.interval; //TESTING
 				uint32_t id = 0;
 
+				// the same masking as in the 1st pass
+				if (opts.dust > 0)
+					dust_mask(reinterpret_cast<const char*>(myseq), len, seed_span, opts.dust, dust_masked);
+
 				uint32_t index_pos = 0; //TESTING
 
 				// for all 19-mers on the sequence
 				for (uint32_t j = 0; j < numwin; j++) //TESTING
 				{
-					// character array to hold an unsigned long long integer for CMPH
-					char a[38] = { 0 };
-					sprintf(a, "%llu", (kmer_key >> 2));
-					const char *key = a;
-					id = cmph_search(hash, key, (cmph_uint32)strlen(key));
+					// spaced seed: the (L+1)-mer is gathered at every position instead of sliding
+					if (seed_offsets_gv.size() > 0)
+					{
+						get_spaced_kmer(myseq, index_pos, sk);
+						kmer_key_short_f = sk.key_f;
+						kmer_key_short_r = sk.key_r;
+						kmer_key_short_f_p = &sk.fwd[partialwin_gv];
+						kmer_key_short_r_rp = &sk.rev[pread_gv - 1 - partialwin_gv];
+						kmer_key = sk.key;
+					}
 
-					//cout << "\t" << id << "=" << (kmer_key>>2); //TESTING
+					// low complexity (L+1)-mer (OPT_DUST) - not in the tries (see the 1st pass)
+					if (opts.dust == 0 || !dust_masked[index_pos])
+					{
+						// character array to hold an unsigned long long integer for CMPH
+						char a[38] = { 0 };
+						sprintf(a, "%llu", (kmer_key >> 2));
+						const char *key = a;
+						id = cmph_search(hash, key, (cmph_uint32)strlen(key));
 
-					add_id_to_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, id);
-					add_id_to_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, id);
+						//cout << "\t" << id << "=" << (kmer_key>>2); //TESTING
 
-					add_kmer_to_table(positions_tbl + id, i, index_pos, opts.max_pos);
+						add_id_to_burst_trie(lookup_table[kmer_key_short_f].trie_F, kmer_key_short_f_p, id);
+						add_id_to_burst_trie(lookup_table[kmer_key_short_r].trie_R, kmer_key_short_r_rp, id);
+
+						add_kmer_to_table(positions_tbl + id, i, index_pos, opts.max_pos);
+					}
 
 					// shift the 19-mer and 9-mers
-					if (j != numwin - 1)
+					if (j != numwin - 1 && seed_offsets_gv.size() > 0)
+						index_pos += opts.interval;
+					else if (j != numwin - 1)
 					{
 						for (uint32_t shift = 0; shift < opts.interval; shift++)
 						{
@@ -2004,6 +2111,31 @@ int build_index(Runopts &opts)
 			}
 			ospos.close();
 
+			// 4. packed references of the part. Loaded by References::load instead of parsing the reference file
+			idx_file = idxpair.second + ".refs_" + part_str + ".dat";
+			DBG(opts.is_verbose, "      writing packed references to %s\n", idx_file.data());
+			{
+				References refs;
+				refs.load_text(idxpair.first, start_part, numseq_part);
+				refs.store(idx_file);
+			}
+
+			// 5. reference clusters. Removed if the index is rebuilt without OPT_CLUSTER_ID
+			idx_file = idxpair.second + ".clust_" + part_str + ".dat";
+			if (opts.cluster_id > 0)
+			{
+				DBG(opts.is_verbose, "      writing reference clusters to %s\n", idx_file.data());
+				if (!clusters.store(idx_file))
+				{
+					ss.str("");
+					ss << STAMP << "Failed to open file: " << idx_file << " for writing. Error: " << strerror(errno);
+					ERR(ss.str());
+					exit(1);
+				}
+			}
+			else
+				std::remove(idx_file.data());
+
 			// Free malloc'd memory
 			// Table of unique 19-mer positions
 			for (uint32_t z = 0; z < number_elements; z++)
@@ -2090,6 +2222,13 @@ int build_index(Runopts &opts)
 				// the length of the sequence itself
 				stats.write(reinterpret_cast<const char*>(&(samheader.second)), sizeof(uint32_t));
 			}
+
+			// spaced seed mask (OPT_SEED_MASK). Length 0 - contiguous seed. Absent in the indexes built before
+			uint32_t mask_len = opts.seed_mask.size();
+			stats.write(reinterpret_cast<const char*>(&mask_len), sizeof(uint32_t));
+			stats.write(opts.seed_mask.data(), mask_len);
+			// DUST threshold of the (L+1)-mers not indexed (OPT_DUST). 0 - off. Absent in the indexes built before
+			stats.write(reinterpret_cast<const char*>(&opts.dust), sizeof(double));
 			stats.close();
 
 			DBG(opts.is_verbose, "    done.\n\n");
@@ -9,10 +9,19 @@
 #include <iostream>
 #include <filesystem>
 
-KeyValueDatabase::KeyValueDatabase(std::string const &kvdbPath) 
+KeyValueDatabase::KeyValueDatabase(std::string const &kvdbPath, std::size_t mem_bytes) 
 {
 	// init and open key-value database for read matches
 	options.IncreaseParallelism();
+	if (mem_bytes > 0)
+	{
+		// half for the block cache, half for 2 memtables (see OPT_MAX_MEMORY)
+		rocksdb::BlockBasedTableOptions table_options;
+		table_options.block_cache = rocksdb::NewLRUCache(mem_bytes / 2);
+		options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+		options.write_buffer_size = mem_bytes / 4;
+		options.max_write_buffer_number = 2;
+	}
 #if defined(_WIN32)
 	options.compression = rocksdb::kXpressCompression;
 #else
@@ -41,4 +50,12 @@ std::string KeyValueDatabase::get(std::string key)
 	std::string val;
 	rocksdb::Status s = kvdb->Get(rocksdb::ReadOptions(), key, &val);
 	return val;
+}
+
+void KeyValueDatabase::get_mem(std::size_t &block_cache, std::size_t &memtables)
+{
+	uint64_t val = 0;
+	block_cache = kvdb->GetIntProperty("rocksdb.block-cache-usage", &val) ? val : 0;
+	val = 0;
+	memtables = kvdb->GetIntProperty("rocksdb.cur-size-all-mem-tables", &val) ? val : 0;
 }
\ No newline at end of file
@@ -42,6 +42,10 @@
 #include "kvdb.hpp"
 #include "index.hpp"
 #include "indexdb.hpp"
+#include "trace.hpp"
+#include "arena.hpp"
+#include "aio.hpp"
+#include "estimate.hpp"
 
 namespace fs = std::filesystem;
 
@@ -62,8 +66,14 @@ int main(int argc, char** argv)
 
 	std::cout << STAMP << "Running command:\n" << opts.cmdline << std::endl;
 
+	if (!opts.trace_file.empty())
+		Trace::start(opts.trace_file.string());
+
+	Arena::set_mode(opts.huge_pages);
+	Aio::set_mode(opts.io_engine);
+
 	Index index(opts); // reference index DB
-	KeyValueDatabase kvdb(opts.kvdbdir.string());
+	KeyValueDatabase kvdb(opts.kvdbdir.string(), opts.kvdb_mem_bytes);
 
 	if (opts.is_cmd) {
 		CmdSession cmd;
@@ -74,28 +84,37 @@ int main(int argc, char** argv)
 		Readstats readstats(opts, kvdb);
 		Output output(opts, readstats);
 
-		switch (opts.alirep)
+		if (opts.estimate_width > 0)
 		{
-		case Runopts::ALIGN_REPORT::align:
-			align(opts, readstats, output, index, kvdb);
-			break;
-		case Runopts::ALIGN_REPORT::postproc:
-			postProcess(opts, readstats, output, kvdb);
-			break;
-		case Runopts::ALIGN_REPORT::report:
-			generateReports(opts, readstats, output, kvdb);
-			break;
-		case Runopts::ALIGN_REPORT::alipost:
-			align(opts, readstats, output, index, kvdb);
-			postProcess(opts, readstats, output, kvdb);
-			break;
-		case Runopts::ALIGN_REPORT::all:
-			align(opts, readstats, output, index, kvdb);
-			postProcess(opts, readstats, output, kvdb);
-			generateReports(opts, readstats, output, kvdb);
-			break;
+			estimate(opts, readstats, output, index);
+		}
+		else
+		{
+			switch (opts.alirep)
+			{
+			case Runopts::ALIGN_REPORT::align:
+				align(opts, readstats, output, index, kvdb);
+				break;
+			case Runopts::ALIGN_REPORT::postproc:
+				postProcess(opts, readstats, output, kvdb);
+				break;
+			case Runopts::ALIGN_REPORT::report:
+				generateReports(opts, readstats, output, kvdb);
+				break;
+			case Runopts::ALIGN_REPORT::alipost:
+				align(opts, readstats, output, index, kvdb);
+				postProcess(opts, readstats, output, kvdb);
+				break;
+			case Runopts::ALIGN_REPORT::all:
+				align(opts, readstats, output, index, kvdb);
+				postProcess(opts, readstats, output, kvdb);
+				generateReports(opts, readstats, output, kvdb);
+				break;
+			}
 		}
 	}
 
+	Trace::write();
+
 	return 0;
 }//~main()
@@ -0,0 +1,164 @@
+/**
+ * FILE: memstats.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <array>
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "common.hpp"
+#include "memstats.hpp"
+#include "index.hpp"
+#include "indexdb.hpp"
+#include "references.hpp"
+#include "readstats.hpp"
+#include "kvdb.hpp"
+
+namespace {
+	std::mutex mem_lock;
+	std::array<std::size_t, MEM_NUM_ITEMS> current = {};
+	std::array<std::size_t, MEM_NUM_ITEMS> peak = {};
+	std::size_t peak_total = 0; // peak of the sum of all items
+
+	const char *item_names[] = { "lookup_tbl", "trie_nodes", "trie_buckets", "positions_tbl", "seed_hash", "ref_sequences", "ref_headers",
+		"read_queue", "write_queue", "reorder_buf", "thread_scratch", "kvdb_cache", "kvdb_memtables", "otu_map" };
+
+	// call under lock
+	void update_peak(MemItem item)
+	{
+		if (current[item] > peak[item]) peak[item] = current[item];
+		std::size_t total = 0;
+		for (auto val : current) total += val;
+		if (total > peak_total) peak_total = total;
+	}
+
+	// resident set size of the process in bytes. 0 if not available
+	std::size_t get_rss()
+	{
+#if defined(__linux__)
+		std::ifstream statm("/proc/self/statm");
+		std::size_t pages = 0;
+		std::size_t rss = 0;
+		if (statm >> pages >> rss)
+			return rss * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+		return 0;
+	}
+
+	double to_mb(std::size_t bytes) { return bytes / 1048576.0; }
+}
+
+void MemStats::set(MemItem item, std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lg(mem_lock);
+	current[item] = bytes;
+	update_peak(item);
+}
+
+void MemStats::add(MemItem item, std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lg(mem_lock);
+	current[item] += bytes;
+	update_peak(item);
+}
+
+void MemStats::count(Index &index)
+{
+	set(MEM_LOOKUP_TBL, index.lookup_tbl.capacity() * sizeof(kmer));
+	set(MEM_TRIE_NODES, index.arena_bytes - index.bucket_bytes);
+	set(MEM_TRIE_BUCKETS, index.bucket_bytes);
+	set(MEM_POSITIONS_TBL, index.positions_tbl.capacity() * sizeof(kmer_origin) + index.positions_bytes);
+	set(MEM_SEED_HASH, index.seed_hash.mem_size());
+}
+
+void MemStats::count(References &refs)
+{
+	std::size_t seq_bytes = 0;
+	std::size_t hdr_bytes = 0;
+	refs.mem_size(seq_bytes, hdr_bytes);
+	set(MEM_REF_SEQUENCES, seq_bytes);
+	set(MEM_REF_HEADERS, hdr_bytes);
+}
+
+void MemStats::count(KeyValueDatabase &kvdb)
+{
+	std::size_t cache_bytes = 0;
+	std::size_t memtable_bytes = 0;
+	kvdb.get_mem(cache_bytes, memtable_bytes);
+	set(MEM_KVDB_CACHE, cache_bytes);
+	set(MEM_KVDB_MEMTABLES, memtable_bytes);
+}
+
+void MemStats::count(Readstats &readstats)
+{
+	std::lock_guard<std::mutex> omlg(readstats.otu_map_lock);
+	set(MEM_OTU_MAP, readstats.otu_map_bytes); // kept by 'pushOtuMap'
+}
+
+void MemStats::start_phase()
+{
+	std::lock_guard<std::mutex> lg(mem_lock);
+	peak = current;
+	peak_total = 0;
+	for (auto val : current) peak_total += val;
+}
+
+void MemStats::check_budget(double max_mb)
+{
+	if (max_mb <= 0) return;
+	std::size_t total = 0;
+	{
+		std::lock_guard<std::mutex> lg(mem_lock);
+		for (auto val : current) total += val;
+	}
+	if (to_mb(total) > max_mb * 0.9) // 10% is headroom for the unaccounted memory
+	{
+		std::stringstream ss;
+		ss << STAMP << "Accounted memory " << std::setprecision(2) << std::fixed << to_mb(total)
+			<< " MB exceeds 90% of the memory budget " << max_mb << " MB. Consider re-building the index with a smaller '-m'"
+			<< " (more index parts).";
+		WARN(ss.str());
+	}
+}
+
+std::string MemStats::report(const std::string &title)
+{
+	std::lock_guard<std::mutex> lg(mem_lock);
+	std::stringstream ss;
+	std::size_t total = 0;
+	ss << STAMP << "Memory (MB) " << title << ":" << std::endl;
+	ss << "    " << std::left << std::setw(18) << "item" << std::right << std::setw(12) << "current" << std::setw(12) << "peak" << std::endl;
+	ss << std::setprecision(2) << std::fixed;
+	for (int i = 0; i < MEM_NUM_ITEMS; ++i)
+	{
+		total += current[i];
+		ss << "    " << std::left << std::setw(18) << item_names[i] << std::right
+			<< std::setw(12) << to_mb(current[i]) << std::setw(12) << to_mb(peak[i]) << std::endl;
+	}
+	ss << "    " << std::left << std::setw(18) << "accounted total" << std::right
+		<< std::setw(12) << to_mb(total) << std::setw(12) << to_mb(peak_total) << std::endl;
+	ss << "    " << std::left << std::setw(18) << "process RSS" << std::right << std::setw(12) << to_mb(get_rss()) << std::endl;
+	return ss.str();
+} // ~MemStats::report
+
+std::string MemStats::report_peak(const std::string &phase)
+{
+	std::lock_guard<std::mutex> lg(mem_lock);
+	std::stringstream ss;
+	ss << STAMP << "Memory peak [" << phase << "]:";
+	for (int i = 0; i < MEM_NUM_ITEMS; ++i)
+		ss << " " << item_names[i] << "=" << peak[i];
+	ss << " total=" << peak_total << " rss=" << get_rss() << std::endl;
+	return ss.str();
+}
+
+// ~memstats.cpp
@@ -14,10 +14,12 @@
 #include "options.hpp"
 #include "common.hpp"
 #include "gzip.hpp"
+#include "bam.hpp"
 #include "kvdb.hpp"
 
  // standard
 #include <limits>
+#include <algorithm>
 #include <dirent.h>
 #include <unistd.h>
 #include <sstream>
@@ -123,27 +125,41 @@ void Runopts::opt_reads(const std::string &file)
 		exit(EXIT_FAILURE);
 	}
 
-	bool gzipped = "gz" == file.substr(file.rfind('.') + 1); // file ends with 'gz'
-	std::string line;
-	Gzip gzip(gzipped);
-	int stat = gzip.getline(ifs, line);
-	if (RL_OK == stat)
+	// the compression is detected by the content, not the file extension
+	auto zip = Gzip::detect(ifs);
+	if (zip == ZIP_ZSTD && !Gzip::is_zstd_supported())
+	{
+		ss << STAMP << "The file [" << file << "] is zstd compressed, but this build has no zstd support."
+			<< " Please decompress the file or use a build with zstd.";
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+
+	// (unaligned) BAM: the pairing comes from the flags
+	bool is_bam_paired = false;
+	if (zip == ZIP_GZIP && Bam::detect(ifs, is_bam_paired))
 	{
-		is_gz = gzipped;
+		zip = ZIP_BAM;
+		if (is_bam_paired && mopt.count(OPT_READS) == 1)
+		{
+			is_paired = true;
+			std::cout << STAMP << "The BAM file [" << file << "] holds paired reads (flag 0x1). The mates are expected consecutive" << std::endl;
+		}
 	}
-	else if (!gzipped)
+
+	std::string line;
+	int stat = RL_OK;
+	if (zip != ZIP_BAM) // BAM is validated by 'Bam::detect'
 	{
-		// try reading as gzipped even though file has no 'gz' extension
-		gzip.~Gzip(); // destroy
-		Gzip gzip(true);
+		Gzip gzip(zip);
 		stat = gzip.getline(ifs, line);
-		if (RL_OK == stat) is_gz = true;
 	}
 
-	if (RL_OK == stat && line.size() > 0)
+	if (RL_OK == stat && (zip == ZIP_BAM || line.size() > 0))
 	{
 		have_reads = true;
 		readfiles.push_back(fpath_a.generic_string());
+		readfiles_zip.push_back(zip);
 	}
 	else
 	{
@@ -1013,6 +1029,37 @@ void Runopts::opt_dbg_put_db(const std::string &val)
 	is_dbg_put_kvdb = true;
 }
 
+void Runopts::opt_perf(const std::string &val)
+{
+	is_perf = true;
+}
+
+void Runopts::opt_trace(const std::string &val)
+{
+	if (val.size() == 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_TRACE
+			<< "' option takes an argument - a file path. None was provided.\n" << help_trace;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	trace_file = val;
+}
+
+void Runopts::opt_slow_read(const std::string &val)
+{
+	if (val.size() == 0 || std::stoi(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_SLOW_READ
+			<< "' option takes a non-negative integer - a threshold in milliseconds e.g. 100.\n" << help_slow_read;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	slow_read_ms = std::stoi(val);
+}
+
 void Runopts::opt_default(const std::string &opt)
 {
 	std::stringstream ss;
@@ -1181,6 +1228,163 @@ void Runopts::opt_L(const std::string &val)
 	}
 } // ~Runopts::opt_L
 
+void Runopts::opt_max_memory(const std::string &val)
+{
+	if (val.size() == 0 || std::stod(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_MAX_MEMORY
+			<< "' option takes a non-negative number of Mbytes e.g. 8000.\n" << help_max_memory;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	max_memory = std::stod(val);
+}
+
+void Runopts::opt_huge_pages(const std::string &val)
+{
+	if (val != "off" && val != "thp" && val != "hugetlb")
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_HUGE_PAGES << "' takes one of: off | thp | hugetlb. Provided: '" << val << "'\n" << help_huge_pages;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	huge_pages = val;
+}
+
+void Runopts::opt_estimate(const std::string &val)
+{
+	if (val.size() == 0 || std::stod(val) <= 0 || std::stod(val) >= 1)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_ESTIMATE << "' takes a confidence interval width in (0, 1) e.g. 0.01\n" << help_estimate;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	estimate_width = std::stod(val);
+}
+
+void Runopts::opt_max_candidates(const std::string &val)
+{
+	if (val.size() == 0 || std::stoll(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_MAX_CANDIDATES << "' takes a non-negative integer e.g. 1000\n" << help_max_candidates;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	max_candidates = static_cast<uint32_t>(std::stoul(val));
+	is_read_budget = is_read_budget || max_candidates > 0;
+}
+
+void Runopts::opt_max_sw_cells(const std::string &val)
+{
+	if (val.size() == 0 || std::stoll(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_MAX_SW_CELLS << "' takes a non-negative integer e.g. 100000000\n" << help_max_sw_cells;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	max_sw_cells = std::stoull(val);
+	is_read_budget = is_read_budget || max_sw_cells > 0;
+}
+
+void Runopts::opt_max_read_time(const std::string &val)
+{
+	if (val.size() == 0 || std::stoll(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_MAX_READ_TIME << "' takes a non-negative number of microseconds e.g. 50000\n" << help_max_read_time;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	max_read_time = static_cast<uint32_t>(std::stoul(val));
+	is_read_budget = is_read_budget || max_read_time > 0;
+}
+
+void Runopts::opt_dust(const std::string &val)
+{
+	if (val.size() == 0 || std::stod(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_DUST << "' takes a non-negative DUST score e.g. 2\n" << help_dust;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	dust = std::stod(val);
+}
+
+void Runopts::opt_reorder(const std::string &val)
+{
+	if (val.size() == 0 || std::stoll(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_REORDER << "' takes a non-negative number of reads e.g. 1000000\n" << help_reorder;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	reorder = static_cast<uint32_t>(std::stoul(val));
+}
+
+void Runopts::opt_io_engine(const std::string &val)
+{
+	if (val != "stream" && val != "pread" && val != "uring")
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_IO_ENGINE << "' takes one of: stream | pread | uring. Provided: '" << val << "'\n" << help_io_engine;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	io_engine = val;
+}
+
+void Runopts::opt_max_ee(const std::string &val)
+{
+	if (val.size() == 0 || std::stod(val) < 0)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_MAX_EE << "' takes a non-negative number of expected errors e.g. 2\n" << help_max_ee;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	max_ee = std::stod(val);
+}
+
+void Runopts::opt_adaptive_passes(const std::string &val)
+{
+	is_adaptive_passes = true;
+}
+
+void Runopts::opt_seed_mask(const std::string &val)
+{
+	auto weight = std::count(val.begin(), val.end(), '1');
+	if (val.size() == 0 || val.find_first_not_of("01") != std::string::npos || val.front() != '1' || val.back() != '1'
+		|| weight % 2 == 1 || weight < 8 || weight > 26 || val.size() > 2 * weight)
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_SEED_MASK << "' takes a mask of '0' and '1' starting and ending with '1', with an even number"
+			<< " of '1' between 8 and 26 and at most as many '0'. Provided: '" << val << "'\n" << help_seed_mask;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	seed_mask = val;
+}
+
+void Runopts::opt_cluster_id(const std::string &val)
+{
+	double id = val.size() == 0 ? -1 : std::stod(val);
+	if (id != 0 && (id < 0.8 || id > 1))
+	{
+		std::stringstream ss;
+		ss << STAMP << "'" << OPT_CLUSTER_ID << "' takes an identity between 0.8 and 1 e.g. 0.97, or 0 - off\n" << help_cluster_id;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	cluster_id = id;
+}
+
 void Runopts::opt_max_pos(const std::string &val)
 {
 	std::stringstream ss;
@@ -1711,8 +1915,67 @@ void Runopts::validate()
 		if (is_otu_map) min_cov = 0.97;
 		else min_cov = 0;
 	}
+
+	// the spaced seed sets the seed length
+	if (seed_mask.size() > 0)
+	{
+		uint32_t weight = static_cast<uint32_t>(std::count(seed_mask.begin(), seed_mask.end(), '1'));
+		if (mopt.count(OPT_L) > 0 && seed_win_len != weight)
+		{
+			ss.str("");
+			ss << STAMP << "Option '" << OPT_L << "' " << seed_win_len << " is overridden by the number of '1' in '"
+				<< OPT_SEED_MASK << "': " << weight;
+			WARN(ss.str());
+		}
+		seed_win_len = weight;
+	}
+
+	if (max_memory > 0)
+		validate_max_memory();
 } // ~Runopts::validate
 
+/*
+ * Split the memory budget OPT_MAX_MEMORY between the consumers:
+ *   60% index part (the index and the references of a single part are resident at a time)
+ *   10% read and write queues (5% each)
+ *   10% KVDB block cache and memtables
+ *   10% OTU map. Spilled to disk when exceeded.
+ *    5% reads buffered for the reordering (OPT_REORDER). Pushed to the read queue when exceeded.
+ *    5% headroom: processor threads working reads, output buffers, allocator overhead
+ * The budget is checked against the accounted memory after every index part is loaded (see MemStats).
+ */
+void Runopts::validate_max_memory()
+{
+	std::stringstream ss;
+	const double MB = 1024 * 1024;
+	double index_mb = max_memory * 0.6;
+
+	if (mopt.count(OPT_M) == 0)
+	{
+		max_file_size = std::min(max_file_size, index_mb);
+	}
+	else if (max_file_size > index_mb)
+	{
+		ss << STAMP << "'-" << OPT_M << " " << max_file_size << "' is larger than the index share (60%) of '--"
+			<< OPT_MAX_MEMORY << " " << max_memory << "'. The index parts may not fit into the memory budget.";
+		WARN(ss.str());
+	}
+
+	queue_max_bytes = static_cast<std::size_t>(max_memory * 0.05 * MB);
+	kvdb_mem_bytes = static_cast<std::size_t>(max_memory * 0.1 * MB);
+	otu_map_max_bytes = static_cast<std::size_t>(max_memory * 0.1 * MB);
+	reorder_max_bytes = static_cast<std::size_t>(max_memory * 0.05 * MB);
+
+	ss.str("");
+	ss << STAMP << "Memory budget: " << max_memory << " MB. Index part: " << max_file_size << " MB"
+		<< " Queue: " << queue_max_bytes / MB << " MB each KVDB: " << kvdb_mem_bytes / MB << " MB"
+		<< " OTU map: " << otu_map_max_bytes / MB << " MB";
+	if (reorder > 0)
+		ss << " Reorder buffer: " << reorder_max_bytes / MB << " MB";
+	ss << std::endl;
+	std::cout << ss.str();
+} // ~Runopts::validate_max_memory
+
 /* 
  * human readable representation of the options
  */
@@ -49,6 +49,8 @@
 #include "read.hpp"
 #include "options.hpp"
 #include "refstats.hpp"
+#include "trace.hpp"
+#include "memstats.hpp"
 
 
 // forward
@@ -64,7 +66,9 @@ Summary::Summary():
 	min_read_len(0),
 	max_read_len(0),
 	all_reads_len(0),
-	total_otu(0)
+	total_otu(0),
+	reads_over_budget(0),
+	est_sampled(0)
 {}
 
 Output::Output(Runopts& opts, Readstats& readstats)
@@ -268,8 +272,8 @@ void Output::report_blast
 				* refstats.full_read[refs.num]
 				* std::exp(-refstats.gumbel[refs.num].first * read.hits_align_info.alignv[i].score1);
 
-			std::string refseq = refs.buffer[read.hits_align_info.alignv[i].ref_seq].sequence;
-			std::string ref_id = refs.buffer[read.hits_align_info.alignv[i].ref_seq].id;
+			auto refseq = refs.sequence(read.hits_align_info.alignv[i].ref_seq);
+			auto ref_id = refs.id(read.hits_align_info.alignv[i].ref_seq);
 
 			if (read.hits_align_info.alignv[i].strand)
 				strandmark = '+';
@@ -569,7 +573,7 @@ void Output::report_sam
 			if (!read.hits_align_info.alignv[i].strand) sam_os << "\t16\t";
 			else sam_os << "\t0\t";
 			// (3) Subject
-			sam_os << refs.buffer[read.hits_align_info.alignv[i].ref_seq].id;
+			sam_os << refs.id(read.hits_align_info.alignv[i].ref_seq);
 			// (4) Ref start
 			sam_os << "\t" << read.hits_align_info.alignv[i].ref_begin1 + 1;
 			// (5) mapq
@@ -907,6 +911,7 @@ void Output::writeLog(Runopts &opts, Refstats &refstats, Readstats &readstats)
 	summary.min_read_len = readstats.min_read_len.load();
 	summary.max_read_len = readstats.max_read_len.load();
 	summary.all_reads_len = readstats.all_reads_len;
+	summary.reads_over_budget = readstats.reads_over_budget.load();
 
 	// stats by database
 	for (uint32_t index_num = 0; index_num < opts.indexfiles.size(); index_num++)
@@ -918,7 +923,7 @@ void Output::writeLog(Runopts &opts, Refstats &refstats, Readstats &readstats)
 	if (opts.is_otu_map) {
 		summary.is_otumapout = opts.is_otu_map;
 		summary.total_reads_mapped_cov = readstats.total_reads_mapped_cov.load();
-		summary.total_otu = readstats.otu_map.size();
+		summary.total_otu = readstats.otu_count();
 	}
 
 	std::stringstream ss;
@@ -962,14 +967,14 @@ void Output::writeLog(Runopts &opts, Refstats &refstats, Readstats &readstats)
 	if (opts.otumapout)
 	{
 		logstream << " Total reads passing %%id and %%coverage thresholds = " << readstats.total_reads_mapped_cov.load() << std::endl;
-		logstream << " Total OTUs = " << readstats.otu_map.size() << std::endl;
+		logstream << " Total OTUs = " << readstats.otu_count() << std::endl;
 	}
 	logstream << std::endl << " " << asctime(now) << std::endl;
 #endif
 	log_os.close();
 } // ~Output::writeLog
 
-void Output::write_a_read(std::ofstream& strm, Read& read)
+void Output::write_a_read(std::ostream& strm, Read& read)
 {
 	strm << read.header << std::endl << read.sequence << std::endl;
 	if (read.format == Format::FASTQ)
@@ -1012,6 +1017,11 @@ std::string Summary::to_string(Runopts &opts, Refstats &refstats)
 	ss << "    Total reads = " << total_reads << std::endl << std::endl;
 
 	ss << " Results:" << std::endl;
+	if (est_sampled > 0)
+	{
+		ss << "    Estimated from a random sample of " << est_sampled << " reads."
+			<< " Counts are extrapolated. [95% confidence interval]" << std::endl;
+	}
 	if (is_de_novo_otu)
 	{
 		// all reads that have read::hit_denovo == true
@@ -1020,19 +1030,31 @@ std::string Summary::to_string(Runopts &opts, Refstats &refstats)
 	// output total non-rrna + rrna reads
 	ss << std::setprecision(2) << std::fixed
 		<< "    Total reads passing E-value threshold = " << total_reads_mapped
-		<< " (" << ((float)total_reads_mapped / (float)total_reads * 100) << ")" << std::endl
+		<< " (" << ((float)total_reads_mapped / (float)total_reads * 100) << ")";
+	if (est_sampled > 0)
+		ss << " [" << mapped_ci.first << ", " << mapped_ci.second << "]";
+	ss << std::endl
 		<< "    Total reads failing E-value threshold = " << total_reads - total_reads_mapped
 		<< " (" << (1 - ((float)((float)total_reads_mapped / (float)total_reads))) * 100 << ")" << std::endl
 		<< "    Minimum read length = " << min_read_len << std::endl
 		<< "    Maximum read length = " << max_read_len << std::endl
-		<< "    Mean read length    = " << all_reads_len / total_reads << std::endl << std::endl;
+		<< "    Mean read length    = " << all_reads_len / total_reads << std::endl;
+	if (reads_over_budget > 0)
+	{
+		// the reads were finalized with the best alignments found within the budget
+		ss << "    Read searches over the work budget = " << reads_over_budget << std::endl;
+	}
+	ss << std::endl;
 
 	ss << " Coverage by database:" << std::endl;
 
 	// output stats by database
-	for (auto match: db_matches)
+	for (std::size_t i = 0; i < db_matches.size(); ++i)
 	{
-		ss << "    " << match.first << "\t\t" << match.second << std::endl;
+		ss << "    " << db_matches[i].first << "\t\t" << db_matches[i].second;
+		if (i < db_ci.size())
+			ss << "\t[" << db_ci[i].first << ", " << db_ci[i].second << "]";
+		ss << std::endl;
 	}
 
 	if (is_otumapout)
@@ -1058,6 +1080,8 @@ void generateReports(Runopts & opts, Readstats & readstats, Output & output, Key
 	std::cout << ss.str();
 
 	ThreadPool tpool(N_READ_THREADS + N_PROC_THREADS);
+	TraceSpan report_span("report", "report");
+	MemStats::start_phase();
 	bool indb = readstats.restoreFromDb(kvdb);
 
 	if (indb) {
@@ -1068,6 +1092,7 @@ void generateReports(Runopts & opts, Readstats & readstats, Output & output, Key
 
 	ReadsQueue readQueue("read_queue", opts.queue_size_max, N_READ_THREADS); // shared: Processor pops, Reader pushes
 	ReadsQueue writeQueue("write_queue", opts.queue_size_max, N_PROC_THREADS); // Not used for Reports
+	readQueue.set_max_bytes(opts.queue_max_bytes);
 	Refstats refstats(opts, readstats);
 	References refs;
 
@@ -1085,12 +1110,20 @@ void generateReports(Runopts & opts, Readstats & readstats, Output & output, Key
 			std::cout << ss.str(); ss.str("");
 
 			auto starts = std::chrono::high_resolution_clock::now();
+			std::string trace_args = "\"index\":" + std::to_string(index_num) + ",\"part\":" + std::to_string(idx_part + 1);
+			int64_t trace_ts = Trace::now();
 
 			refs.load(index_num, idx_part, opts, refstats);
+			Trace::complete("refs_load", "index", trace_ts, trace_args);
 			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - starts; // ~20 sec Debug/Win
 			ss << "done [" << std::setprecision(2) << std::fixed << elapsed.count() << " sec]" << std::endl;
 			std::cout << ss.str(); ss.str("");
 
+			MemStats::count(refs);
+			MemStats::count(kvdb);
+			std::cout << MemStats::report("after loading reference " + std::to_string(index_num) + " part "
+				+ std::to_string(idx_part + 1) + "/" + std::to_string(refstats.num_index_parts[index_num]));
+
 			starts = std::chrono::high_resolution_clock::now(); // index processing starts
 
 			for (int i = 0; i < N_READ_THREADS; ++i)
@@ -1103,10 +1136,16 @@ void generateReports(Runopts & opts, Readstats & readstats, Output & output, Key
 			{
 				tpool.addJob(ReportProcessor("report_proc_" + std::to_string(i), readQueue, opts, refs, output, refstats, reportsJob));
 			}
+			trace_ts = Trace::now();
 			tpool.waitAll(); // wait till processing is done on one index part
+			Trace::complete("wait_all", "pool", trace_ts, trace_args);
+			MemStats::set(MEM_READ_QUEUE, readQueue.bytes_peak());
+			MemStats::count(kvdb);
 			refs.clear();
 			writeQueue.reset(N_PROC_THREADS);
 			readQueue.reset(N_READ_THREADS);
+			MemStats::count(refs);
+			MemStats::set(MEM_READ_QUEUE, 0);
 
 			elapsed = std::chrono::high_resolution_clock::now() - starts; // index processing done
 			ss.str("");
@@ -1118,4 +1157,5 @@ void generateReports(Runopts & opts, Readstats & readstats, Output & output, Key
 	} // ~for(index_num)
 
 	std::cout << "\n" << STAMP << "=== Done Reports generation ===\n\n";
+	std::cout << MemStats::report_peak("report");
 } // ~generateReports
\ No newline at end of file
@@ -0,0 +1,83 @@
+/**
+ * FILE: pairs.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <iostream>
+
+#include "common.hpp"
+#include "options.hpp"
+#include "read.hpp"
+#include "pairs.hpp"
+
+namespace {
+	bool is_pairs = false;
+	bool is_paired_in = false; // otherwise paired_out
+	bool is_two_files = false;
+	std::size_t num_words = 0;
+	std::unique_ptr<std::atomic<uint64_t>[]> decided; // bit per pair
+	std::atomic<uint64_t> num_skipped(0);
+
+	// mates share the read number in two files, and are consecutive in a single (interleaved) file
+	uint64_t pair_id(const Read &read) { return is_two_files ? read.read_num : read.read_num / 2; }
+}
+
+void Pairs::open(Runopts &opts, uint64_t num_reads)
+{
+	is_pairs = (opts.is_paired_in || opts.is_paired_out) && opts.is_fastx
+		&& !(opts.is_sam || opts.is_blast || opts.is_otu_map || opts.is_de_novo_otu);
+	if (!is_pairs)
+		return;
+
+	is_paired_in = opts.is_paired_in;
+	is_two_files = opts.readfiles.size() == 2;
+	num_words = (num_reads / 2 + 64) / 64;
+	decided.reset(new std::atomic<uint64_t>[num_words]);
+	for (std::size_t i = 0; i < num_words; ++i)
+		decided[i] = 0;
+	num_skipped = 0;
+
+	std::stringstream ss;
+	ss << STAMP << "Paired early exit: a mate is not searched once its pair is decided ("
+		<< (is_paired_in ? OPT_PAIRED_IN : OPT_PAIRED_OUT) << ")" << std::endl;
+	std::cout << ss.str();
+}
+
+void Pairs::close()
+{
+	if (!is_pairs)
+		return;
+	is_pairs = false;
+	decided.reset();
+	std::stringstream ss;
+	ss << STAMP << "Paired early exit: skipped mate searches: " << num_skipped.load() << std::endl;
+	std::cout << ss.str();
+}
+
+bool Pairs::is_on() { return is_pairs; }
+
+bool Pairs::is_decided(const Read &read)
+{
+	if (!is_pairs) return false;
+	auto id = pair_id(read);
+	if (id / 64 >= num_words) return false;
+	return (decided[id / 64].load(std::memory_order_relaxed) >> (id % 64)) & 1;
+}
+
+void Pairs::update(const Read &read, bool is_last_part)
+{
+	if (!is_pairs) return;
+	bool is_decision = is_paired_in ? read.is_hit : (is_last_part && !read.is_hit);
+	auto id = pair_id(read);
+	if (is_decision && id / 64 < num_words)
+		decided[id / 64].fetch_or(uint64_t(1) << (id % 64), std::memory_order_relaxed);
+}
+
+void Pairs::skipped() { ++num_skipped; }
+
+// ~pairs.cpp
@@ -56,6 +56,12 @@
 #include "writer.hpp"
 #include "output.hpp"
 #include "read_control.hpp"
+#include "perfcounters.hpp"
+#include "trace.hpp"
+#include "memstats.hpp"
+#include "slowreads.hpp"
+#include "pairs.hpp"
+#include "dust.hpp"
 
 
 #if defined(_WIN32)
@@ -75,6 +81,7 @@ int clear_dir(std::string dpath);
  * Callback run in a Processor thread
  * Called on each index * index_part * read.num_strands
  *
+ * @param scratch      working storage of the calling Processor thread
  * @param isLastStrand Boolean flags when the last strand is passed for matching
  */
 void alignmentCb
@@ -86,6 +93,7 @@ void alignmentCb
 		Readstats & readstats, 
 		Refstats & refstats, 
 		Read & read,
+		AlignScratch & scratch,
 		bool isLastStrand
 	)
 {
@@ -119,12 +127,12 @@ void alignmentCb
 	//	readstats.max_read_len = static_cast<uint32_t>(read.sequence.size());
 
 	// the read length is too short
-	if (read.sequence.size()  < refstats.lnwin[index.index_num])
+	if (read.sequence.size()  < refstats.win_span[index.index_num])
 	{
 		std::stringstream ss;
 		ss << STAMP << "Processor thread: " << std::this_thread::get_id()
 			<< " The read.id: " << read.id << " read.header: " << read.header << " is shorter than "
-			<< refstats.lnwin[index.index_num] << " nucleotides, by default it will not be searched";
+			<< refstats.win_span[index.index_num] << " nucleotides, by default it will not be searched";
 		WARN(ss.str());
 
 		read.isValid = false;
@@ -134,18 +142,78 @@ void alignmentCb
 	uint32_t windowshift = opts.skiplengths[index.index_num][0];
 	// keep track of windows (read positions) which have been already traversed in the burst trie
 	// initially all False
-	vector<bool> read_pos_searched(read.sequence.size());
+	auto & read_pos_searched = scratch.read_pos_searched;
+	read_pos_searched.assign(read.sequence.size(), false);
+
+	// low complexity windows (OPT_DUST) are not searched
+	auto & dust_masked = scratch.dust_masked;
+	uint64_t num_masked = 0;
+	if (opts.dust > 0)
+		dust_mask(read.isequence.data(), read.isequence.size(), refstats.win_span[index.index_num], opts.dust, dust_masked);
+
+	// low quality windows (OPT_MAX_EE) are not searched
+	auto & win_ee = scratch.win_ee;
+	uint64_t num_low_qual = 0;
+	bool is_qual = false;
+	if (opts.max_ee > 0)
+	{
+		read.expected_errors(refstats.win_span[index.index_num], win_ee);
+		is_qual = !win_ee.empty();
+	}
 
 	uint32_t pass_n = 0; // Pass number (possible value 0,1,2)
 	uint32_t max_SW_score = read.sequence.size() *opts.match; // the maximum SW score attainable for this read
 
-	std::vector<UCHAR> bitvec; // window (prefix/suffix) bitvector
+	auto & bitvec = scratch.bitvec; // window (prefix/suffix) bitvector
 
 	// TODO: below 2 values are unique per index part. Move to index?
 	uint32_t bitvec_size = (refstats.partialwin[index.index_num] - 2) << 2; // e.g. 9 - 2 = 0000 0111 << 2 = 0001 1100 = 28
 	// Does this mark where in 32-bit the bitvector starts?
 	uint32_t offset = (refstats.partialwin[index.index_num] - 3) << 2; // e.g. 9 - 3 = 0000 0110 << 2 = 0001 1000 = 24
 
+	// spaced seed (OPT_SEED_MASK): the window nt at the mask positions are gathered and searched as a contiguous seed
+	auto const & seed_offsets = refstats.seed_offsets[index.index_num];
+	char spaced_win[32];
+	uint32_t partialwin = refstats.partialwin[index.index_num];
+	auto hash_kmer = [](const char *kmer, uint32_t len) { // see Read::hashKmer
+		uint32_t hash = 0;
+		for (uint32_t i = 0; i < len; i++)
+			(hash <<= 2) |= (uint32_t)kmer[i];
+		return hash;
+	};
+	// the seed nt of the window at the read position
+	auto seed_at = [&](uint32_t win_pos) {
+		char *win = &read.isequence[win_pos];
+		if (!seed_offsets.empty())
+		{
+			for (uint32_t i = 0; i < seed_offsets.size(); ++i)
+				spaced_win[i] = read.isequence[win_pos + seed_offsets[i]];
+			win = spaced_win;
+		}
+		return win;
+	};
+
+	// adaptive passes (OPT_ADAPTIVE_PASSES): a pass is run only if it can align the read
+	uint64_t num_skipped = 0; // passes skipped
+	// a window can hit only if the index has its first half (forward trie) or its second half (reverse trie)
+	auto is_searchable = [&](uint32_t win_pos) {
+		const char *win = seed_at(win_pos);
+		auto const & half_f = index.lookup_tbl[hash_kmer(win, partialwin)];
+		auto const & half_r = index.lookup_tbl[hash_kmer(win + partialwin, partialwin)];
+		return (half_f.count > opts.minoccur && half_f.trie_F != NULL) || (half_r.count > opts.minoccur && half_r.trie_R != NULL);
+	};
+	auto can_align = [&](uint32_t shift) {
+		uint32_t num_new = 0; // windows of the pass not searched yet, that can hit
+		for (uint32_t pos = 0; pos + refstats.win_span[index.index_num] <= read.sequence.size(); pos += shift)
+		{
+			if (read_pos_searched[pos] || (opts.dust > 0 && dust_masked[pos]) || (is_qual && win_ee[pos] > opts.max_ee))
+				continue;
+			if (is_searchable(pos)) ++num_new;
+		}
+		// even if all the new windows hit, the read has too few hits
+		return read.readhit + num_new >= (uint32_t)opts.seed_hits;
+	};
+
 	// loop search positions on the read in multiple passes
 	// changing the step (windowshift) when necessary
 	for (bool search = true; search; )
@@ -153,35 +221,49 @@ void alignmentCb
 		// number of k-mer windows fit along the read given 
 		// the window size and a search step (windowshift)
 		uint32_t numwin = ( read.sequence.size()
-				- refstats.lnwin[index.index_num]
+				- refstats.win_span[index.index_num]
 				+ windowshift ) / windowshift;
 
-		uint32_t win_pos = 0; // position (index) of the window's first char on the read i.e. [0..read.sequence.length-1]
 		// iterate the windows
 		for (uint32_t win_num = 0; win_num < numwin; win_num++)
 		{
+			// position (index) of the window's first char on the read i.e. [0..read.sequence.length-1]
+			uint32_t win_pos = win_num * windowshift;
+
 			if (read.is04) read.flip34(); // Make sure the read is in 03 encoding for index search
 
+			// low complexity window: mark it searched, so it is counted once over the passes
+			if (opts.dust > 0 && !read_pos_searched[win_pos] && dust_masked[win_pos])
+			{
+				read_pos_searched[win_pos].flip();
+				++num_masked;
+				if (read_diag) ++read_diag->masked;
+			}
+
+			// low quality window: same as above
+			if (is_qual && !read_pos_searched[win_pos] && win_ee[win_pos] > opts.max_ee)
+			{
+				read_pos_searched[win_pos].flip();
+				++num_low_qual;
+			}
+
 			// skip position when the seed at this position has already been searched for in a previous Passes
 			if (!read_pos_searched[win_pos])
 			{
 				read_pos_searched[win_pos].flip(); // mark position as searched
+				if (read_diag) ++read_diag->windows;
 				// this flag it set to true if a match is found during
 				// subsearch 1(a), to skip subsearch 1(b)
 				bool accept_zero_kmer = false;
 				// ids for k-mers that hit the database
-				vector<id_win> id_hits; // TODO: add directly to 'id_win_hits'? - No, id_win_hits may contain hits from different index parts.
-
-				bitvec.resize(bitvec_size);
-				std::fill(bitvec.begin(), bitvec.end(), 0);
+				auto & id_hits = scratch.id_hits; // TODO: add directly to 'id_win_hits'? - No, id_win_hits may contain hits from different index parts.
+				id_hits.clear();
 
-				init_win_f(&read.isequence[win_pos + refstats.partialwin[index.index_num]],
-					&bitvec[0],
-					&bitvec[4],
-					refstats.numbvs[index.index_num]);
+				// the seed nt of the window
+				char *win = seed_at(win_pos);
 
 				// the hash of the first half of the kmer window
-				uint32_t keyf = read.hashKmer(win_pos, refstats.partialwin[index.index_num]);
+				uint32_t keyf = hash_kmer(win, partialwin);
 
 				// TODO: remove in production
 				if (index.lookup_tbl.size() <= keyf) {
@@ -204,9 +286,25 @@ void alignmentCb
 					exit(EXIT_FAILURE);
 				}
 
+				bitvec.resize(bitvec_size);
+
+				// small index part: an exact match of the window is looked up without the trie search (see SeedHash)
+				uint32_t seed_id = 0;
+				if (index.seed_hash.is_built()
+					&& index.seed_hash.find(keyf, hash_kmer(win + partialwin, partialwin), seed_id))
+				{
+					id_hits.push_back(id_win(seed_id, win_pos));
+					accept_zero_kmer = true;
+				}
 				// do traversal if the exact half window exists in the burst trie
-				if ( index.lookup_tbl[keyf].count > opts.minoccur && index.lookup_tbl[keyf].trie_F != NULL )
+				else if ( index.lookup_tbl[keyf].count > opts.minoccur && index.lookup_tbl[keyf].trie_F != NULL )
 				{
+					std::fill(bitvec.begin(), bitvec.end(), 0);
+					index.kernels->init_win_f(win + partialwin,
+						&bitvec[0],
+						&bitvec[4],
+						refstats.numbvs[index.index_num]);
+
 					/* subsearch (1)(a) d([p_1],[w_1]) = 0 and d([p_2],[w_2]) <= 1;
 					*
 					*  w = |------ [w_1] ------|------ [w_2] ------|
@@ -217,7 +315,7 @@ void alignmentCb
 					*    = |------ [p_1] ------|------ [p_2] --------| (0/1 insertion in [p_2])
 					*
 					*/
-					traversetrie_align(
+					index.kernels->traversetrie_align(
 						index.lookup_tbl[keyf].trie_F,
 						0,
 						0,
@@ -239,13 +337,13 @@ void alignmentCb
 					std::fill(bitvec.begin(), bitvec.end(), 0);
 
 					// init the first bitvector window
-					init_win_r(&read.isequence[win_pos + refstats.partialwin[index.index_num] - 1],
+					index.kernels->init_win_r(win + partialwin - 1,
 						&bitvec[0],
 						&bitvec[4],
 						refstats.numbvs[index.index_num]);
 
 					// the hash of the second (rear) half of the kmer window
-					uint32_t keyr = read.hashKmer(win_pos + refstats.partialwin[index.index_num], refstats.partialwin[index.index_num]);
+					uint32_t keyr = hash_kmer(win + partialwin, partialwin);
 
 					// TODO: remove in production
 					if (index.lookup_tbl.size() <= keyr) {
@@ -281,7 +379,7 @@ void alignmentCb
 						*    = |------- [p_1] --------|---- [p_2] ---------| (1 insertion in [p_1])
 						*
 						*/
-						traversetrie_align(
+						index.kernels->traversetrie_align(
 							index.lookup_tbl[keyr].trie_R,
 							0,
 							0,
@@ -312,11 +410,16 @@ void alignmentCb
 			{
 				compute_lis_alignment(
 					read, opts, index, refs, readstats, refstats,
+					scratch,
 					search, // returns False if the alignment is found -> stop searching
 					max_SW_score,
 					read_to_count
 				);
 
+				// the work budget of the read is used up - no next pass
+				if (search && opts.is_read_budget && scratch.budget.check(opts))
+					search = false;
+
 				// the read was not accepted at current window shift,
 				// use the next (smaller) window shift
 				if (search)
@@ -333,14 +436,32 @@ void alignmentCb
 						// set interval skip length for next Pass
 						else windowshift = opts.skiplengths[index.index_num][pass_n];
 					}
+
+					// skip the denser passes that cannot align the read given the hits so far
+					if (search && opts.is_adaptive_passes)
+					{
+						if (read.is04) read.flip34(); // 03 encoding for the index look up
+						while (search && !can_align(windowshift))
+						{
+							++num_skipped;
+							while (pass_n < 2 && opts.skiplengths[index.index_num][pass_n] == opts.skiplengths[index.index_num][pass_n + 1])
+								++pass_n;
+							if (++pass_n > 2) search = false;
+							else windowshift = opts.skiplengths[index.index_num][pass_n];
+						}
+					}
 				}
 				break; // last possible position reached for given window and skip length -> go to the next skip length
 			}//~( win_num == NUMWIN-1 )
-			win_pos += windowshift;
 		}//~for (each window)                
 			//~while all three window skip lengths have not been tested, or a match has not been found
 	}// ~while (search);
 
+	if (read_diag) read_diag->max_hits = std::max(read_diag->max_hits, read.id_win_hits.size());
+	if (num_masked > 0) readstats.windows_masked += num_masked;
+	if (num_low_qual > 0) readstats.windows_low_quality += num_low_qual;
+	if (num_skipped > 0) readstats.passes_skipped += num_skipped;
+
 	// the read didn't align (for --num_alignments [INT] option),
 	// output null alignment string
 	if (isLastStrand && !read.is_hit && opts.num_alignments > -1) // !opts.forward
@@ -390,6 +511,8 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 	ThreadPool tpool(numThreads);
 	ReadsQueue readQueue("read_queue", opts.queue_size_max, opts.num_read_thread); // shared: Processor pops, Reader pushes
 	ReadsQueue writeQueue("write_queue", opts.queue_size_max, numProcThread); // shared: Processor pushes, Writer pops
+	readQueue.set_max_bytes(opts.queue_max_bytes);
+	writeQueue.set_max_bytes(opts.queue_max_bytes);
 	Refstats refstats(opts, readstats);
 	References refs;
 
@@ -398,6 +521,11 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 	// perform alignment
 	auto starts = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double> elapsed;
+	int64_t trace_ts = 0; // trace span start
+	TraceSpan align_span("align", "align");
+	MemStats::start_phase();
+	SlowReads::open(opts); // no-op unless '--slow_read'
+	Pairs::open(opts, readstats.all_reads_count); // no-op unless '--paired_in' | '--paired_out' with FASTA/Q output only
 
 	// loop through every index passed to option '--ref'
 	for (uint16_t index_num = 0; index_num < (uint16_t)opts.indexfiles.size(); ++index_num)
@@ -410,21 +538,34 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 				<< " part " << idx_part + 1 << "/" << refstats.num_index_parts[index_num] << " ... ";
 			std::cout << ss.str();
 			starts = std::chrono::high_resolution_clock::now();
+			std::string trace_args = "\"index\":" + std::to_string(index_num) + ",\"part\":" + std::to_string(idx_part + 1);
+			trace_ts = Trace::now();
 
 			index.load(index_num, idx_part, opts, refstats);
 
+			Trace::complete("index_load", "index", trace_ts, trace_args);
+
 			elapsed = std::chrono::high_resolution_clock::now() - starts; // ~20 sec Debug/Win
 			ss.str("");
 			ss << "done [" << std::setprecision(2) << std::fixed << elapsed.count() << "] sec" << std::endl;
+			if (index.seed_hash.is_built())
+				ss << STAMP << "Small index part: " << index.seed_hash.size() << " exact seeds hashed ("
+					<< index.seed_hash.mem_size() / 1048576.0 << " MB)" << std::endl;
+			if (index.clusters.is_loaded())
+				ss << STAMP << "Reference clusters: " << index.clusters.num_centroids() << " centroids indexed of "
+					<< index.clusters.size() << " references" << std::endl;
 			std::cout << ss.str();
 
 			ss.str("");
 			ss << STAMP << "Loading references " << " ... ";
 			std::cout << ss.str();
 			starts = std::chrono::high_resolution_clock::now();
+			trace_ts = Trace::now();
 
 			refs.load(index_num, idx_part, opts, refstats);
 
+			Trace::complete("refs_load", "index", trace_ts, trace_args);
+
 //			std::chrono::duration<double> elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
 			elapsed = std::chrono::high_resolution_clock::now() - starts; // ~20 sec Debug/Win
 
@@ -432,6 +573,14 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			ss << "done [" << std::setprecision(2) << std::fixed << elapsed.count() << "] sec\n";
 			std::cout << ss.str();
 
+			MemStats::count(index);
+			MemStats::count(refs);
+			MemStats::count(kvdb);
+			MemStats::check_budget(opts.max_memory);
+			std::cout << MemStats::report("after loading index " + std::to_string(index_num) + " part " 
+				+ std::to_string(idx_part + 1) + "/" + std::to_string(refstats.num_index_parts[index_num]));
+			std::cout << Arena::report({ {"index", &index.arena}, {"references", &refs.get_arena()} });
+
 			starts = std::chrono::high_resolution_clock::now();
 			for (int i = 0; i < opts.num_read_thread; i++)
 			{
@@ -450,11 +599,22 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 			}
 			++loopCount;
 
+			trace_ts = Trace::now();
 			tpool.waitAll(); // wait till all reads are processed against the current part
+			Trace::complete("wait_all", "pool", trace_ts, trace_args);
+			MemStats::set(MEM_READ_QUEUE, readQueue.bytes_peak());
+			MemStats::set(MEM_WRITE_QUEUE, writeQueue.bytes_peak());
+			MemStats::count(kvdb);
 			index.clear();
 			refs.clear();
 			writeQueue.reset(numProcThread);
 			readQueue.reset(opts.num_read_thread);
+			// the peaks are recorded. Back to the current values for the next part
+			MemStats::count(index);
+			MemStats::count(refs);
+			MemStats::set(MEM_READ_QUEUE, 0);
+			MemStats::set(MEM_WRITE_QUEUE, 0);
+			MemStats::set(MEM_THREAD_SCRATCH, 0); // summed up by the processors of the next part
 
 			elapsed = std::chrono::high_resolution_clock::now() - starts;
 
@@ -468,6 +628,59 @@ void align(Runopts & opts, Readstats & readstats, Output & output, Index &index,
 	ss.str("");
 	ss << "\n" << STAMP << "==== Done alignment ====\n\n";
 	std::cout << ss.str();
+	std::cout << MemStats::report_peak("align");
+	SlowReads::close();
+	Pairs::close();
+
+	if (opts.dust > 0)
+	{
+		ss.str("");
+		ss << STAMP << "Low complexity read windows skipped (" << OPT_DUST << " " << opts.dust << "): "
+			<< readstats.windows_masked.load() << std::endl;
+		std::cout << ss.str();
+	}
+
+	if (opts.max_ee > 0)
+	{
+		ss.str("");
+		ss << STAMP << "Low quality read windows skipped (" << OPT_MAX_EE << " " << opts.max_ee << "): "
+			<< readstats.windows_low_quality.load() << std::endl;
+		std::cout << ss.str();
+	}
+
+	ss.str("");
+	ss << STAMP << "Smith-Waterman 8-bit only: " << readstats.sw_8bit.load() << " 16-bit only: " << readstats.sw_16bit.load()
+		<< " (8-bit reruns avoided: " << readstats.sw_reruns_avoided.load() << ") 8-bit rerun with 16-bit: "
+		<< readstats.sw_reruns.load() << " Near exact without Smith-Waterman: " << readstats.near_exact_aligned.load() << std::endl;
+	std::cout << ss.str();
+
+	if (opts.is_adaptive_passes)
+	{
+		ss.str("");
+		ss << STAMP << "Seed search passes skipped (" << OPT_ADAPTIVE_PASSES << "): " << readstats.passes_skipped.load() << std::endl;
+		std::cout << ss.str();
+	}
+
+	if (readstats.cluster_members_tried > 0)
+	{
+		ss.str("");
+		ss << STAMP << "Cluster members aligned to (" << OPT_CLUSTER_ID << "): " << readstats.cluster_members_tried.load()
+			<< " passing the minimal score: " << readstats.cluster_members_aligned.load() << std::endl;
+		std::cout << ss.str();
+	}
+
+	if (opts.is_read_budget)
+	{
+		ss.str("");
+		ss << STAMP << "Read searches over the work budget (read x index part): " << readstats.reads_over_budget.load() << std::endl;
+		std::cout << ss.str();
+	}
+
+	if (opts.is_perf)
+	{
+		std::cout << PerfCounters::report();
+		PerfCounters::reset();
+	}
 
 	// store readstats calculated in alignment
 	readstats.set_is_total_reads_mapped_cov(); // TODO: seems not necessary here. See TODO: alignment.cpp:569
@@ -0,0 +1,247 @@
+/**
+ * FILE: perfcounters.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstring> // strerror
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "common.hpp"
+#include "perfcounters.hpp"
+
+namespace {
+	thread_local PerfCounters *current = nullptr; // counters of the calling thread
+
+	std::mutex registry_lock;
+	std::map<std::string, std::array<perf_values, static_cast<int>(PerfStage::NUM_STAGES)>> registry; // thread id : counts per stage
+	std::array<bool, PERF_NUM_EVENTS> is_event_seen = {}; // event was available on at least one thread
+	std::atomic<bool> is_warned(false);
+
+	const char *stage_names[] = { "other", "seed", "lis", "sw", "parse", "kvdb" };
+	const char *event_names[] = { "cycles", "instructions", "LLC-misses", "dTLB-misses", "branch-misses" };
+
+#if defined(__linux__)
+	int open_event(uint32_t type, uint64_t config, int group_fd)
+	{
+		struct perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = group_fd == -1 ? 1 : 0; // the group is enabled through the leader
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+		// pid = 0, cpu = -1 : the calling thread on any CPU
+		return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+	}
+#endif
+}
+
+PerfCounters::PerfCounters(const std::string &id, bool is_enabled)
+	: id(id), last{}, counts{}
+{
+	fds.fill(-1);
+	if (!is_enabled)
+		return;
+
+#if defined(__linux__)
+	const std::array<std::pair<uint32_t, uint64_t>, PERF_NUM_EVENTS> events = { {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	} };
+
+	// cycles is the group leader. Without it nothing is collected.
+	group_fd = open_event(events[PERF_CYCLES].first, events[PERF_CYCLES].second, -1);
+	if (group_fd < 0)
+	{
+		if (!is_warned.exchange(true))
+		{
+			std::stringstream ss;
+			ss << STAMP << "Hardware performance counters are not available (perf_event_open: " << std::strerror(errno)
+				<< "). Check /proc/sys/kernel/perf_event_paranoid. Continuing without counters.";
+			WARN(ss.str());
+		}
+		return;
+	}
+	fds[PERF_CYCLES] = group_fd;
+
+	for (int i = PERF_CYCLES + 1; i < PERF_NUM_EVENTS; ++i)
+		fds[i] = open_event(events[i].first, events[i].second, group_fd); // -1 if not supported
+
+	ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	read_group(last);
+
+	stages.push_back(PerfStage::OTHER);
+	prev = current;
+	current = this;
+#else
+	if (!is_warned.exchange(true))
+	{
+		WARN("Hardware performance counters are only supported on Linux. Continuing without counters.");
+	}
+#endif
+} // ~PerfCounters::PerfCounters
+
+PerfCounters::~PerfCounters()
+{
+	if (group_fd < 0)
+		return;
+
+	account();
+#if defined(__linux__)
+	ioctl(group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for (int i = PERF_NUM_EVENTS - 1; i >= 0; --i)
+	{
+		if (fds[i] >= 0) close(fds[i]);
+	}
+#endif
+	current = prev;
+
+	std::lock_guard<std::mutex> lg(registry_lock);
+	auto &thread_counts = registry[id];
+	for (int stg = 0; stg < static_cast<int>(PerfStage::NUM_STAGES); ++stg)
+		for (int ev = 0; ev < PERF_NUM_EVENTS; ++ev)
+			thread_counts[stg][ev] += counts[stg][ev];
+	for (int ev = 0; ev < PERF_NUM_EVENTS; ++ev)
+		if (fds[ev] >= 0) is_event_seen[ev] = true;
+} // ~PerfCounters::~PerfCounters
+
+/*
+ * read all counters of the group in a single system call
+ * Layout (PERF_FORMAT_GROUP | PERF_FORMAT_ID): nr, {value, id} * nr  in the order the events were opened
+ */
+bool PerfCounters::read_group(perf_values &vals)
+{
+#if defined(__linux__)
+	uint64_t buf[1 + 2 * PERF_NUM_EVENTS];
+	if (::read(group_fd, buf, sizeof(buf)) <= 0)
+		return false;
+	uint64_t nr = buf[0];
+	uint64_t idx = 0;
+	for (int i = 0; i < PERF_NUM_EVENTS && idx < nr; ++i)
+	{
+		if (fds[i] < 0) continue;
+		vals[i] = buf[1 + 2 * idx];
+		++idx;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* attribute the counts since the last switch to the stage on top of the stack */
+void PerfCounters::account()
+{
+	perf_values now = last;
+	if (!read_group(now))
+		return;
+	auto &stage_counts = counts[static_cast<int>(stages.back())];
+	for (int i = 0; i < PERF_NUM_EVENTS; ++i)
+		stage_counts[i] += now[i] - last[i];
+	last = now;
+}
+
+void PerfCounters::push(PerfStage stage)
+{
+	if (group_fd < 0) return;
+	account();
+	stages.push_back(stage);
+}
+
+void PerfCounters::pop()
+{
+	if (group_fd < 0) return;
+	account();
+	if (stages.size() > 1)
+		stages.pop_back();
+}
+
+void PerfCounters::swap(PerfStage stage)
+{
+	if (group_fd < 0) return;
+	account();
+	stages.back() = stage;
+}
+
+std::string PerfCounters::report()
+{
+	std::lock_guard<std::mutex> lg(registry_lock);
+	if (registry.empty())
+		return "";
+
+	std::stringstream ss;
+	std::array<perf_values, static_cast<int>(PerfStage::NUM_STAGES)> totals{};
+
+	auto print_row = [&ss](const std::string &thread, int stg, const perf_values &vals) {
+		ss << "    " << std::left << std::setw(14) << thread << std::setw(7) << stage_names[stg] << std::right;
+		for (int ev = 0; ev < PERF_NUM_EVENTS; ++ev)
+		{
+			if (is_event_seen[ev]) ss << std::setw(16) << vals[ev];
+			else ss << std::setw(16) << "n/a";
+		}
+		if (vals[PERF_CYCLES] > 0)
+			ss << std::setw(8) << std::setprecision(2) << std::fixed << (double)vals[PERF_INSTRUCTIONS] / vals[PERF_CYCLES];
+		ss << std::endl;
+	};
+
+	ss << STAMP << "Hardware performance counters (user space) per thread and stage:" << std::endl;
+	ss << "    " << std::left << std::setw(14) << "thread" << std::setw(7) << "stage" << std::right;
+	for (int ev = 0; ev < PERF_NUM_EVENTS; ++ev)
+		ss << std::setw(16) << event_names[ev];
+	ss << std::setw(8) << "IPC" << std::endl;
+
+	for (auto const &entry : registry)
+	{
+		for (int stg = 0; stg < static_cast<int>(PerfStage::NUM_STAGES); ++stg)
+		{
+			if (entry.second[stg][PERF_CYCLES] == 0) continue;
+			print_row(entry.first, stg, entry.second[stg]);
+			for (int ev = 0; ev < PERF_NUM_EVENTS; ++ev)
+				totals[stg][ev] += entry.second[stg][ev];
+		}
+	}
+	for (int stg = 0; stg < static_cast<int>(PerfStage::NUM_STAGES); ++stg)
+	{
+		if (totals[stg][PERF_CYCLES] == 0) continue;
+		print_row("total", stg, totals[stg]);
+	}
+	return ss.str();
+} // ~PerfCounters::report
+
+void PerfCounters::reset()
+{
+	std::lock_guard<std::mutex> lg(registry_lock);
+	registry.clear();
+}
+
+PerfScope::PerfScope(PerfStage stage) : pc(current)
+{
+	if (pc) pc->push(stage);
+}
+
+PerfScope::~PerfScope()
+{
+	if (pc) pc->pop();
+}
+
+// ~perfcounters.cpp
@@ -21,9 +21,15 @@
 #include "references.hpp"
 #include "options.hpp"
 #include "read.hpp"
+#include "alignment.hpp"
 #include "ThreadPool.hpp"
 #include "read_control.hpp"
 #include "writer.hpp"
+#include "perfcounters.hpp"
+#include "trace.hpp"
+#include "memstats.hpp"
+#include "slowreads.hpp"
+#include "pairs.hpp"
 
 // forward
 void computeStats(Read & read, Readstats & readstats, Refstats & refstats, References & refs, Runopts & opts);
@@ -35,6 +41,7 @@ void Processor::run()
 	int countProcessed = 0;
 	std::size_t num_aligned = 0; // count of reads with read.hit = true
 	bool alreadyProcessed = false;
+	std::size_t scratch_peak = 0; // peak memory of the working read incl. the seed hits (MemStats)
 	
 	{
 		std::stringstream ss;
@@ -42,6 +49,14 @@ void Processor::run()
 		std::cout << ss.str();
 	}
 
+	PerfCounters perf(id, opts.is_perf); // no-op unless '--perf'
+	Trace::thread_name(id);
+	TraceBatch batch("align_reads", "align", id); // no-op unless '--trace'
+	SlowReads slow; // no-op unless '--slow_read'
+	AlignScratch scratch; // reused for all the reads of this thread
+	bool is_last_part = index.index_num == opts.indexfiles.size() - 1
+		&& index.part == refstats.num_index_parts[index.index_num] - 1u; // see Pairs::update
+
 	for (;;)
 	{
 		Read read = readQueue.pop(); // returns an empty read if queue is empty
@@ -56,6 +71,12 @@ void Processor::run()
 			continue;
 		}
 
+		// the mate decided the destination of the pair - nothing to store for this read
+		if (Pairs::is_decided(read)) {
+			Pairs::skipped();
+			continue;
+		}
+
 		// search the forward and/or reverse strands depending on Run options
 		int32_t num_strands = 0;
 		//opts.forward = true; // TODO: this discards the possiblity of forward = false
@@ -65,18 +86,36 @@ void Processor::run()
 		else 
 			num_strands = 2; // search both strands. The default when neither -F or -R were specified
 
+		slow.start();
+		scratch.budget.start_read();
+		read.id_win_hits.swap(scratch.win_hits); // use the thread's buffer. Empty, cleared after each strand
 		for (int32_t count = 0; count < num_strands; ++count)
 		{
+			if (count > 0 && Pairs::is_decided(read)) break; // decided by the mate while searching the first strand
+			if (count > 0 && scratch.budget.is_over) break; // the work budget was used up on the first strand
+
 			if ((search_single_strand && opts.is_reverse) || count == 1)
 			{
 				if (!read.reversed)
 					read.revIntStr();
 			}
 			// call 'paralleltraversal.cpp::alignmentCb'
-			callback(opts, index, refs, output, readstats, refstats, read, search_single_strand || count == 1);
+			{
+				PerfScope perf_seed(PerfStage::SEED);
+				callback(opts, index, refs, output, readstats, refstats, read, scratch, search_single_strand || count == 1);
+			}
+			scratch_peak = std::max(scratch_peak, read.mem_size() + scratch.mem_size());
 			//opts.forward = false;
 			read.id_win_hits.clear(); // bug 46
 		}
+		read.id_win_hits.swap(scratch.win_hits);
+		if (scratch.budget.is_over)
+		{
+			read.is_over_budget = true;
+			++readstats.reads_over_budget;
+		}
+		slow.finish(read, index.index_num, index.part);
+		Pairs::update(read, is_last_part);
 
 		if (read.isValid && !read.isEmpty) 
 		{
@@ -85,10 +124,12 @@ void Processor::run()
 		}
 
 		countReads++;
+		batch.add();
 	}
 
 	writeQueue.decrPushers(); // signal this processor done adding
 	writeQueue.notify(); // notify in case no Reads were ever pushed to the Write queue
+	MemStats::add(MEM_THREAD_SCRATCH, scratch_peak);
 
 	{
 		std::stringstream ss;
@@ -112,6 +153,9 @@ void PostProcessor::run()
 		std::cout << ss.str();
 	}
 
+	Trace::thread_name(id);
+	TraceBatch batch("postproc_reads", "postproc", id); // no-op unless '--trace'
+
 	for (;;)
 	{
 		Read read = readQueue.pop(); // returns an empty read if queue is empty
@@ -126,6 +170,7 @@ void PostProcessor::run()
 
 		callback(read, readstats, refstats, refs, opts);
 		++countReads;
+		batch.add();
 		if (read.is_hit) ++count_reads_aligned;
 
 		if (read.isValid && !read.isEmpty && !read.is_denovo)
@@ -160,6 +205,8 @@ void ReportProcessor::run()
 	Read read;
 	std::size_t i = 0;
 	bool isDone = false;
+	Trace::thread_name(id);
+	TraceBatch batch("report_reads", "report", id); // no-op unless '--trace'
 
 	for (;!isDone;)
 	{
@@ -184,6 +231,7 @@ void ReportProcessor::run()
 
 		callback(reads, opts, refs, refstats, output);
 		countReads+=i;
+		batch.add(i);
 	}
 
 	{
@@ -210,6 +258,8 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 	ThreadPool tpool(N_READ_THREADS + N_PROC_THREADS + opts.num_write_thread);
 	ReadsQueue readQueue("read_queue", opts.queue_size_max, N_READ_THREADS); // shared: Processor pops, Reader pushes
 	ReadsQueue writeQueue("write_queue", opts.queue_size_max, N_PROC_THREADS); // shared: Processor pushes, Writer pops
+	readQueue.set_max_bytes(opts.queue_max_bytes);
+	writeQueue.set_max_bytes(opts.queue_max_bytes);
 	bool indb = readstats.restoreFromDb(kvdb);
 
 	if (indb) {
@@ -220,6 +270,9 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 
 	readstats.total_reads_denovo_clustering = 0; // TODO: to prevent incrementing the stored value. Change this if ever using 'stats_calc_done"
 
+	TraceSpan postproc_span("postproc", "postproc");
+	MemStats::start_phase();
+
 	//if (!readstats.stats_calc_done)
 	//{
 		Refstats refstats(opts, readstats);
@@ -239,7 +292,10 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 				}
 
 				auto starts = std::chrono::high_resolution_clock::now(); // index loading start
+				std::string trace_args = "\"index\":" + std::to_string(index_num) + ",\"part\":" + std::to_string(idx_part + 1);
+				int64_t trace_ts = Trace::now();
 				refs.load(index_num, idx_part, opts, refstats);
+				Trace::complete("refs_load", "index", trace_ts, trace_args);
 				std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - starts;
 
 				{
@@ -248,6 +304,11 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 					std::cout << ss.str();
 				}
 
+				MemStats::count(refs);
+				MemStats::count(kvdb);
+				std::cout << MemStats::report("after loading reference " + std::to_string(index_num) + " part "
+					+ std::to_string(idx_part + 1) + "/" + std::to_string(refstats.num_index_parts[index_num]));
+
 				starts = std::chrono::high_resolution_clock::now(); // index processing starts
 
 				for (int i = 0; i < N_READ_THREADS; ++i)
@@ -266,10 +327,19 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 					tpool.addJob(PostProcessor("postproc_" + std::to_string(i), readQueue, writeQueue, opts, refs, readstats, refstats, computeStats));
 				}
 				++loopCount;
+				trace_ts = Trace::now();
 				tpool.waitAll(); // wait till processing is done on one index part
+				Trace::complete("wait_all", "pool", trace_ts, trace_args);
+				MemStats::set(MEM_READ_QUEUE, readQueue.bytes_peak());
+				MemStats::set(MEM_WRITE_QUEUE, writeQueue.bytes_peak());
+				MemStats::count(readstats);
+				MemStats::count(kvdb);
 				refs.clear();
 				readQueue.reset(N_READ_THREADS);
 				writeQueue.reset(N_PROC_THREADS);
+				MemStats::count(refs);
+				MemStats::set(MEM_READ_QUEUE, 0);
+				MemStats::set(MEM_WRITE_QUEUE, 0);
 
 				elapsed = std::chrono::high_resolution_clock::now() - starts;
 
@@ -294,14 +364,25 @@ void postProcess(Runopts & opts, Readstats & readstats, Output & output, KeyValu
 		readstats.store_to_db(kvdb); // store reads statistics computed by post-processor
 	//} // ~if !readstats.stats_calc_done
 
-	output.writeLog(opts, refstats, readstats);
+	{
+		TraceSpan span("write_log", "report");
+		if (opts.is_otu_map)
+			readstats.printOtuMap(output.otumap_f); // before the log as it counts the OTUs of the spilled map
 
-	if (opts.is_otu_map)
-		readstats.printOtuMap(output.otumap_f);
+		output.writeLog(opts, refstats, readstats);
+	}
 
 	{
 		std::stringstream ss;
 		ss << "\n" << STAMP << "==== Done Post-processing (alignment statistics report) ====\n\n";
 		std::cout << ss.str();
 	}
+	std::cout << MemStats::report("after post-processing");
+	std::cout << MemStats::report_peak("postproc");
+
+	if (opts.is_perf)
+	{
+		std::cout << PerfCounters::report();
+		PerfCounters::reset();
+	}
 } // ~postProcess
\ No newline at end of file
@@ -3,6 +3,8 @@
  * Created: Nov 26, 2017 Sun
  * @copyright 2016-20 Clarity Genomics BVBA
  */
+#include <array>
+#include <cmath>
 #include <filesystem>
 
 // 3rd party
@@ -105,6 +107,7 @@ Read::Read()
 	num_alignments(0),
 	readhit(0),
 	best(0),
+	is_over_budget(false),
 	format(Format::FASTA)
 {}
 
@@ -113,7 +116,7 @@ Read::~Read(){}
 Read::Read(std::string id, std::string header, std::string sequence, std::string quality, Format format)
 	:
 	id(id), header(std::move(header)), sequence(sequence),
-	quality(quality), format(format), isEmpty(false)
+	quality(quality), format(format), isEmpty(false), is_over_budget(false)
 {
 	validate();
 }
@@ -145,6 +148,7 @@ Read::Read(const Read & that)
 	num_alignments = that.num_alignments;
 	readhit = that.readhit;
 	best = that.best;
+	is_over_budget = that.is_over_budget;
 	id_win_hits = that.id_win_hits;
 	hits_align_info = that.hits_align_info;
 	scoring_matrix = that.scoring_matrix;
@@ -180,6 +184,7 @@ Read & Read::operator=(const Read & that)
 	num_alignments = that.num_alignments;
 	readhit = that.readhit;
 	best = that.best;
+	is_over_budget = that.is_over_budget;
 	id_win_hits = that.id_win_hits;
 	hits_align_info = that.hits_align_info;
 	scoring_matrix = that.scoring_matrix;
@@ -270,6 +275,7 @@ void Read::clear()
 	num_alignments = 0;
 	readhit = 0;
 	best = 0;
+	is_over_budget = false;
 	id_win_hits.clear();
 	hits_align_info.clear();
 	scoring_matrix.clear();
@@ -406,6 +412,7 @@ std::string Read::toString()
 	size_t hits_align_info_size = hits_align_info_str.length();
 	std::copy_n(static_cast<char*>(static_cast<void*>(&hits_align_info_size)), sizeof(hits_align_info_size), std::back_inserter(buf)); // add size
 	buf += hits_align_info_str; //  add string
+	std::copy_n(static_cast<char*>(static_cast<void*>(&is_over_budget)), sizeof(is_over_budget), std::back_inserter(buf));
 
 	return buf;
 } // ~Read::toString
@@ -470,6 +477,13 @@ bool Read::load_db(KeyValueDatabase & kvdb)
 	hits_align_info = alignstruct;
 	offset += hits_align_info_size;
 
+	// is_over_budget (absent in the records stored before OPT_MAX_CANDIDATES etc. were added)
+	if (offset + sizeof(is_over_budget) <= bstr.size())
+	{
+		std::memcpy(static_cast<void*>(&is_over_budget), bstr.data() + offset, sizeof(is_over_budget));
+		offset += sizeof(is_over_budget);
+	}
+
 	isRestored = true;
 	return isRestored;
 } // ~Read::load_db
@@ -504,7 +518,7 @@ void Read::calcMismatchGapId(References & refs, int alignIdx, uint32_t & mismatc
 	int32_t qb = hits_align_info.alignv[alignIdx].ref_begin1; // index of the first char in the reference matched part
 	int32_t pb = hits_align_info.alignv[alignIdx].read_begin1; // index of the first char in the read matched part
 
-	std::string refseq = refs.buffer[hits_align_info.alignv[alignIdx].ref_seq].sequence;
+	auto refseq = refs.sequence(hits_align_info.alignv[alignIdx].ref_seq);
 
 	for (uint32_t cidx = 0; cidx < hits_align_info.alignv[alignIdx].cigar.size(); ++cidx)
 	{
@@ -553,4 +567,52 @@ uint32_t Read::hashKmer(uint32_t pos, uint32_t len)
 		++pKmer;
 	}
 	return hash;
-}
\ No newline at end of file
+}
+/*
+ * Expected number of errors of each window of the read i.e. the sum of the base error
+ * probabilities 10^(-Q/10) (Phred+33) over the window. Indexed by the window start in the
+ * search orientation: the quality is not reverted by 'revIntStr'.
+ *
+ * @param win_len  window length
+ * @param win_ee   out: 'sequence.size() - win_len + 1' values. Empty if the read has no quality
+ */
+void Read::expected_errors(uint32_t win_len, std::vector<float> &win_ee) const
+{
+	static const auto perr = []() {
+		std::array<float, 94> tbl; // Q = 0..93
+		for (std::size_t q = 0; q < tbl.size(); ++q)
+			tbl[q] = static_cast<float>(std::pow(10.0, -static_cast<double>(q) / 10));
+		return tbl;
+	}();
+
+	win_ee.clear();
+	auto len = sequence.size();
+	if (quality.size() != len || len < win_len || win_len == 0)
+		return;
+
+	auto err = [this, len](std::size_t i) {
+		int q = static_cast<unsigned char>(quality[reversed ? len - 1 - i : i]) - 33;
+		return perr[std::min(std::max(q, 0), 93)];
+	};
+	win_ee.resize(len - win_len + 1);
+	double sum = 0; // double: no drift over the long reads
+	for (std::size_t i = 0; i < len; ++i)
+	{
+		sum += err(i);
+		if (i >= win_len) sum -= err(i - win_len);
+		if (i + 1 >= win_len) win_ee[i + 1 - win_len] = static_cast<float>(sum);
+	}
+} // ~Read::expected_errors
+
+/*
+ * Approximate number of bytes held by the read. Uses the content sizes (not capacities),
+ * so a read and its copy have the same size - used for the queue accounting in push/pop.
+ */
+std::size_t Read::mem_size() const
+{
+	std::size_t sz = sizeof(Read) + id.size() + header.size() + sequence.size() + quality.size() + isequence.size()
+		+ ambiguous_nt.size() * sizeof(int) + id_win_hits.size() * sizeof(id_win) + scoring_matrix.size();
+	for (auto const &align : hits_align_info.alignv)
+		sz += sizeof(s_align2) + align.cigar.size() * sizeof(uint32_t);
+	return sz;
+}
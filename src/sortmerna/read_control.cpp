@@ -12,10 +12,47 @@
 #include <chrono> // std::chrono
 #include <thread>
 #include <iomanip> // std::precision
+#include <vector>
+#include <utility> // std::pair
+#include <algorithm> // std::sort
+#include <limits>
 
 #include "common.hpp"
 #include "read_control.hpp"
 #include "read.hpp"
+#include "perfcounters.hpp"
+#include "trace.hpp"
+#include "pairs.hpp"
+#include "aio.hpp"
+#include "memstats.hpp"
+
+namespace {
+	const uint32_t MINIMIZER_K = 16; // k-mer length of the read minimizer (OPT_REORDER)
+
+	uint64_t mix64(uint64_t x)
+	{
+		x ^= x >> 33; x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ULL;
+		return x ^ (x >> 33);
+	}
+
+	// smallest hash of the canonical k-mers of the read i.e. the same for the read and its reverse complement
+	uint64_t minimizer_key(const std::string &iseq)
+	{
+		const uint64_t mask = (uint64_t(1) << (2 * MINIMIZER_K)) - 1;
+		uint64_t fwd = 0, rev = 0;
+		uint64_t key = std::numeric_limits<uint64_t>::max();
+		for (std::size_t i = 0; i < iseq.size(); ++i)
+		{
+			uint64_t nt = iseq[i] & 3;
+			fwd = ((fwd << 2) | nt) & mask;
+			rev = (rev >> 2) | ((3 - nt) << (2 * (MINIMIZER_K - 1)));
+			if (i + 1 >= MINIMIZER_K)
+				key = std::min(key, mix64(std::min(fwd, rev)));
+		}
+		return key;
+	}
+}
 
 
 ReadControl::ReadControl(Runopts & opts, ReadsQueue & readQueue, KeyValueDatabase & kvdb)
@@ -42,9 +79,9 @@ void ReadControl::run()
 	bool is_two_reads = opts.readfiles.size() == 2; // i.e. 2 read files are supplied
 
 	// init FWD Reader
-	Reader reader_fwd("reader_fwd", opts.is_gz);
+	Reader reader_fwd("reader_fwd", opts.readfiles_zip[IDX_FWD_READS]);
 	auto fwd_file = opts.readfiles[IDX_FWD_READS];
-	std::ifstream ifs_fwd(fwd_file, std::ios_base::in | std::ios_base::binary);
+	AioIfstream ifs_fwd(fwd_file, std::ios_base::in | std::ios_base::binary);
 
 	if (!ifs_fwd.is_open()) 
 	{
@@ -53,8 +90,8 @@ void ReadControl::run()
 	}
 
 	// init REV Reader
-	std::ifstream ifs_rev;
-	Reader reader_rev("reader_rev", opts.is_gz);
+	AioIfstream ifs_rev;
+	Reader reader_rev("reader_rev", is_two_reads ? opts.readfiles_zip[IDX_REV_READS] : Runopts::ZIP_NONE);
 	if (is_two_reads)
 	{
 		auto rev_file = opts.readfiles[IDX_REV_READS];
@@ -70,6 +107,47 @@ void ReadControl::run()
 	ss << STAMP << "thread: " << std::this_thread::get_id() << " started" << std::endl;
 	std::cout << ss.str();
 	auto t = std::chrono::high_resolution_clock::now();
+	PerfCounters perf("read_control", opts.is_perf); // no-op unless '--perf'
+	Trace::thread_name("read_control");
+	TraceBatch batch("parse", "read", "read_control"); // no-op unless '--trace'
+
+	// OPT_REORDER: the reads are buffered and pushed sorted by the minimizer, so the reads hitting
+	// the same regions of the tries, positions and references are searched back to back.
+	// The output order is not affected: the results are stored by read id
+	std::vector<Read> reorder_buf;
+	std::vector<std::pair<uint64_t, uint32_t>> reorder_keys; // minimizer, index into 'reorder_buf'
+	std::size_t reorder_bytes = 0; // held by 'reorder_buf'. Capped by the memory budget (OPT_MAX_MEMORY)
+	auto flush = [&]() {
+		MemStats::set(MEM_REORDER_BUF, reorder_bytes + reorder_keys.capacity() * sizeof(reorder_keys[0]));
+		std::sort(reorder_keys.begin(), reorder_keys.end());
+		for (auto & key : reorder_keys)
+			readQueue.push(reorder_buf[key.second]);
+		reorder_buf.clear();
+		reorder_keys.clear();
+		reorder_bytes = 0;
+		MemStats::set(MEM_REORDER_BUF, 0);
+	};
+	auto push = [&](Read & read) {
+		if (opts.reorder == 0)
+		{
+			readQueue.push(read);
+			return;
+		}
+		reorder_keys.emplace_back(minimizer_key(read.isequence), static_cast<uint32_t>(reorder_buf.size()));
+		reorder_bytes += read.mem_size();
+		reorder_buf.push_back(read);
+		if (reorder_buf.size() >= opts.reorder || (opts.reorder_max_bytes > 0 && reorder_bytes >= opts.reorder_max_bytes))
+			flush();
+	};
+	if (opts.reorder > 0)
+	{
+		// at most the reads fitting the budget: a read takes sizeof(Read) at least
+		std::size_t num_reserved = opts.reorder;
+		if (opts.reorder_max_bytes > 0)
+			num_reserved = std::min(num_reserved, opts.reorder_max_bytes / sizeof(Read) + 1);
+		reorder_buf.reserve(num_reserved);
+		reorder_keys.reserve(num_reserved);
+	}
 
 	// loop calling Readers
 	for (; !reader_fwd.is_done || (is_two_reads && !reader_rev.is_done);)
@@ -77,33 +155,48 @@ void ReadControl::run()
 		// first push FWD read
 		if (!reader_fwd.is_done)
 		{
+			perf.push(PerfStage::PARSE);
 			Read read = reader_fwd.nextread(ifs_fwd, IDX_FWD_READS, opts);
+			perf.pop();
 
 			if (!read.isEmpty)
 			{
+				perf.push(PerfStage::PARSE);
 				read.init(opts);
+				perf.swap(PerfStage::KVDB);
 				read.load_db(kvdb); // get matches from Key-value database
+				perf.pop();
 				//unmarshallJson(kvdb); // get matches from Key-value database
 				++read_cnt; // save because push(read) uses move(read)
 				if (read.is_hit) ++num_aligned;
-				readQueue.push(read);
+				Pairs::update(read, false); // aligned in a previous run
+				push(read);
+				batch.add();
 			}
 		}
 		// second push REV read (if paired)
 		if (is_two_reads && !reader_rev.is_done)
 		{
+			perf.push(PerfStage::PARSE);
 			Read read = reader_rev.nextread(ifs_rev, IDX_REV_READS, opts);
+			perf.pop();
 
 			if (!read.isEmpty)
 			{
+				perf.push(PerfStage::PARSE);
 				read.init(opts);
+				perf.swap(PerfStage::KVDB);
 				read.load_db(kvdb); // get matches from Key-value database
+				perf.pop();
 				++read_cnt;
 				if (read.is_hit) ++num_aligned;
-				readQueue.push(read);
+				Pairs::update(read, false);
+				push(read);
+				batch.add();
 			}
 		}
 	} // ~for
+	flush();
 
 	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - t;
 	readQueue.decrPushers(); // signal the reader done adding
@@ -17,11 +17,11 @@
 #include "reader.hpp"
 #include "gzip.hpp"
 
-Reader::Reader(std::string id, bool is_gzipped)
+Reader::Reader(std::string id, Runopts::ZIP_FORMAT zip)
 	:
 	id(id),
-	is_gzipped(is_gzipped),
-	gzip(is_gzipped),
+	zip(zip),
+	gzip(zip),
 	is_done(false),
 	read_count(0),
 	line_count(0),
@@ -44,12 +44,30 @@ bool Reader::loadReadByIdx(Runopts & opts, Read & read)
 		std::cerr << STAMP << "failed to open " << opts.readfiles[read.readfile_idx] << std::endl;
 		exit(EXIT_FAILURE);
 	}
+	else if (opts.readfiles_zip[read.readfile_idx] == Runopts::ZIP_BAM)
+	{
+		Reader reader("reader_load", Runopts::ZIP_BAM);
+		while (!reader.is_done)
+		{
+			Read rec = reader.nextread(ifs, read.readfile_idx, opts);
+			if (!rec.isEmpty && rec.read_num == read.read_num)
+			{
+				read.format = rec.format;
+				read.header = rec.header;
+				read.sequence = rec.sequence;
+				read.quality = rec.quality;
+				read.isEmpty = false;
+				isok = true;
+				break;
+			}
+		}
+	}
 	else
 	{
 		std::string line;
 		std::size_t read_num = 0;
 		bool isFastq = true;
-		Gzip gzip(opts.is_gz);
+		Gzip gzip(opts.readfiles_zip[read.readfile_idx]);
 
 		auto t = std::chrono::high_resolution_clock::now();
 
@@ -128,8 +146,11 @@ bool Reader::loadReadById(Runopts & opts, Read & read)
 /** 
  * return next read from the reads file on each call 
  */
-Read Reader::nextread(std::ifstream &ifs, const uint8_t readsfile_idx, Runopts & opts)
+Read Reader::nextread(std::istream &ifs, const uint8_t readsfile_idx, Runopts & opts)
 {
+	if (zip == Runopts::ZIP_BAM)
+		return nextread_bam(ifs, readsfile_idx, opts);
+
 	std::string line;
 	Read read; // an empty read
 
@@ -235,16 +256,76 @@ Read Reader::nextread(std::ifstream &ifs, const uint8_t readsfile_idx, Runopts &
 	return read;
 } // ~Reader::nextread
 
+/**
+ * return next read from the BAM file on each call. The mates of a paired read get '/1' and '/2' in the header
+ */
+Read Reader::nextread_bam(std::istream &ifs, const uint8_t readsfile_idx, Runopts & opts)
+{
+	Read read; // an empty read
+	BamRecord rec;
+
+	auto stat = bam.next(ifs, rec);
+	if (stat == RL_ERR)
+	{
+		std::cerr << STAMP << "ERROR reading from file: [" << opts.readfiles[readsfile_idx] << "]. Exiting..." << std::endl;
+		exit(1);
+	}
+	if (stat == RL_END)
+	{
+		is_done = true;
+		return read;
+	}
+
+	// mates of the single file are paired by the order: first mate on even read numbers
+	if (opts.is_paired && opts.readfiles.size() == 1 && (rec.flag & BAM_FPAIRED)
+		&& !(rec.flag & (read_count % 2 == 0 ? BAM_FREAD1 : BAM_FREAD2)))
+	{
+		std::cerr << STAMP << "ERROR: the BAM record [" << rec.name << "] is out of the mates order (flag " << rec.flag
+			<< "). Please group the mates e.g. 'samtools collate'. Exiting..." << std::endl;
+		exit(1);
+	}
+
+	read.format = rec.quality.empty() ? Format::FASTA : Format::FASTQ;
+	read.header.reserve(rec.name.size() + 3);
+	read.header += read.format == Format::FASTQ ? FASTQ_HEADER_START : FASTA_HEADER_START;
+	read.header += rec.name;
+	if (rec.flag & BAM_FPAIRED)
+		read.header += (rec.flag & BAM_FREAD2) ? "/2" : "/1";
+	read.sequence = std::move(rec.sequence);
+	read.quality = std::move(rec.quality);
+	read.isEmpty = false;
+	read.read_num = read_count;
+	read.readfile_idx = readsfile_idx;
+	read.generate_id();
+	++read_count;
+	return read;
+} // ~Reader::nextread_bam
+
 /**
  * get a next read sequence from the reads file
  * @return true if record exists, else false
  */
-bool Reader::nextread(std::ifstream& ifs, const std::string &readsfile, std::string &seq)
+bool Reader::nextread(std::istream& ifs, const std::string &readsfile, std::string &seq)
 {
 	bool has_seq = false;
 	seq = ""; // ensure empty
 	std::string line;
 
+	if (zip == Runopts::ZIP_BAM)
+	{
+		BamRecord rec;
+		auto stat = bam.next(ifs, rec);
+		if (stat == RL_ERR)
+		{
+			std::cerr << STAMP << "ERROR reading from file: [" << readsfile << "]. Exiting..." << std::endl;
+			exit(1);
+		}
+		is_done = stat == RL_END;
+		if (!is_done) ++read_count;
+		seq = std::move(rec.sequence);
+		return !is_done;
+	}
+
 	// read lines from the reads file and create Read object
 	for (int count = last_count, stat = last_stat; !is_done; ++count) // count lines in a single record/read
 	{
@@ -323,7 +404,7 @@ bool Reader::nextread(std::ifstream& ifs, const std::string &readsfile, std::str
 /**
  * test if there is a next read in the reads file
  */
-bool Reader::hasnext(std::ifstream& ifs)
+bool Reader::hasnext(std::istream& ifs)
 {
 	bool is_next = false;
 	return is_next;
@@ -338,4 +419,5 @@ void Reader::reset()
 	bool isFastq = false;
 	bool isFasta = false;
 	is_done = false;
+	bam = Bam(); // restart at the header
 }
\ No newline at end of file
@@ -26,6 +26,9 @@
 #include "readstats.hpp"
 #include "kvdb.hpp"
 #include "gzip.hpp"
+#include "bam.hpp"
+#include "aio.hpp"
+#include "estimate.hpp"
 
 // forward
 std::string string_hash(const std::string &val); // util.cpp
@@ -37,12 +40,29 @@ Readstats::Readstats(Runopts &opts, KeyValueDatabase &kvdb)
 	max_read_len(0),
 	total_reads_aligned(0),
 	total_reads_mapped_cov(0),
+	reads_over_budget(0),
+	windows_masked(0),
+	windows_low_quality(0),
+	cluster_members_tried(0),
+	cluster_members_aligned(0),
+	sw_8bit(0),
+	sw_16bit(0),
+	sw_reruns_avoided(0),
+	sw_reruns(0),
+	near_exact_aligned(0),
+	passes_skipped(0),
 	all_reads_count(0),
 	all_reads_len(0),
 	reads_matched_per_db(opts.indexfiles.size(), 0),
 	total_reads_denovo_clustering(0),
+	otu_map_bytes(0),
+	otu_map_max_bytes(opts.otu_map_max_bytes),
+	otu_spill_pfx(opts.outdir / "otu_map_spill_"),
+	total_otu(0),
 	is_stats_calc(false),
-	is_total_reads_mapped_cov(false)
+	is_total_reads_mapped_cov(false),
+	sample_max(opts.estimate_width > 0 ? estimate_sample_size(opts.estimate_width) : 0),
+	sample_rng(ESTIMATE_SEED)
 {
 	// calculate this->dbkey
 	std::string key_str_tmp("");
@@ -61,7 +81,8 @@ Readstats::Readstats(Runopts &opts, KeyValueDatabase &kvdb)
 
 	if (!opts.exit_early)
 	{
-		if (!is_restored || !(is_restored && all_reads_count > 0 && all_reads_len > 0))
+		// the estimate sample is taken in this pass
+		if (!is_restored || !(is_restored && all_reads_count > 0 && all_reads_len > 0) || sample_max > 0)
 		{
 			calculate(opts);
 			store_to_db(kvdb);
@@ -84,15 +105,27 @@ Readstats::Readstats(Runopts &opts, KeyValueDatabase &kvdb)
 void Readstats::calculate(Runopts &opts)
 {
 	std::stringstream ss;
-
-	for (auto readfile : opts.readfiles)
+	// the counts restored from the KVDB are recalculated with the estimate sample
+	all_reads_count = 0;
+	all_reads_len = 0;
+	min_read_len = MAX_READ_LEN;
+	max_read_len = 0;
+	sample.clear();
+
+	for (std::size_t idx = 0; idx < opts.readfiles.size(); ++idx)
 	{
-		std::ifstream ifs(readfile, std::ios_base::in | std::ios_base::binary);
+		auto readfile = opts.readfiles[idx];
+		AioIfstream ifs(readfile, std::ios_base::in | std::ios_base::binary);
 		if (!ifs.is_open()) {
 			ss << STAMP << "Failed to open Reads file: " << readfile;
 			ERR(ss.str());
 			exit(EXIT_FAILURE);
 		}
+		else if (opts.readfiles_zip[idx] == Runopts::ZIP_BAM)
+		{
+			calculate_bam(ifs, readfile, static_cast<uint8_t>(idx));
+			ifs.close();
+		}
 		else
 		{
 			std::string line; // line from the Reads file
@@ -100,7 +133,9 @@ void Readstats::calculate(Runopts &opts)
 			bool isFastq = false;
 			bool isFasta = false;
 			uint64_t tcount = 0; // count of lines in a file
-			Gzip gzip(opts.is_gz);
+			uint64_t file_start = all_reads_count; // reads of the previous files
+			SampledRead *sampled = nullptr; // the current read is in the estimate sample
+			Gzip gzip(opts.readfiles_zip[idx]);
 
 			auto t = std::chrono::high_resolution_clock::now();
 
@@ -196,6 +231,12 @@ void Readstats::calculate(Runopts &opts)
 
 					count = 0; // FASTA record start
 					sequence.clear(); // clear container for the new record
+					sampled = sample_slot(all_reads_count, static_cast<uint8_t>(idx), all_reads_count - file_start);
+					if (sampled)
+					{
+						sampled->format = isFastq ? Format::FASTQ : Format::FASTA;
+						sampled->header = line;
+					}
 				} // ~if header line
 				else
 				{
@@ -212,11 +253,17 @@ void Readstats::calculate(Runopts &opts)
 							ERR(ss.str());
 							exit(EXIT_FAILURE);
 						}
-						if (count == 3 || line[0] == '+')
+						if (count == 3)
+						{
+							if (sampled) sampled->quality = line;
 							continue; // fastq.quality
+						}
+						if (line[0] == '+')
+							continue;
 					} // ~if fastq
 
 					sequence += line; // fasta multiline sequence
+					if (sampled) sampled->sequence += line;
 				}
 			} // ~for getline
 
@@ -232,8 +279,86 @@ void Readstats::calculate(Runopts &opts)
 	} // ~for iterating reads files
 } // ~Readstats::calculate
 
+/*
+ * statistics of a BAM Reads file: the primary records are the reads
+ */
+void Readstats::calculate_bam(std::istream &ifs, const std::string &readfile, uint8_t readfile_idx)
+{
+	std::stringstream ss;
+	Bam bam;
+	BamRecord rec;
+	uint64_t file_start = all_reads_count; // reads of the previous files
+
+	auto t = std::chrono::high_resolution_clock::now();
+	std::cout << STAMP << "Starting statistics calculation on file: '" << readfile << "'  ...   ";
+
+	for (int stat = bam.next(ifs, rec); stat != RL_END; stat = bam.next(ifs, rec))
+	{
+		if (stat == RL_ERR)
+		{
+			ss << STAMP << "Failed reading from file '" << readfile << "' Exiting...";
+			ERR(ss.str());
+			exit(EXIT_FAILURE);
+		}
+
+		// the header as 'Reader::nextread_bam' makes it
+		SampledRead *sampled = sample_slot(all_reads_count, readfile_idx, all_reads_count - file_start);
+		if (sampled)
+		{
+			sampled->format = rec.quality.empty() ? Format::FASTA : Format::FASTQ;
+			sampled->header += sampled->format == Format::FASTQ ? FASTQ_HEADER_START : FASTA_HEADER_START;
+			sampled->header += rec.name;
+			if (rec.flag & BAM_FPAIRED)
+				sampled->header += (rec.flag & BAM_FREAD2) ? "/2" : "/1";
+			sampled->sequence = rec.sequence;
+			sampled->quality = rec.quality;
+		}
+
+		++all_reads_count;
+		all_reads_len += rec.sequence.length();
+
+		if (rec.sequence.size() < min_read_len.load())
+			min_read_len = static_cast<uint32_t>(rec.sequence.size());
+
+		if (rec.sequence.size() > max_read_len.load())
+			max_read_len = static_cast<uint32_t>(rec.sequence.size());
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - t;
+	ss << std::setprecision(2) << std::fixed << STAMP
+		<< "Done statistics on file. Elapsed time: " << elapsed.count()
+		<< " sec. all_reads_count= " << all_reads_count << std::endl;
+	std::cout << ss.str();
+} // ~Readstats::calculate_bam
+
+/*
+ * reservoir sampling (algorithm R) for OPT_ESTIMATE: the read number 'read_count' over all the files
+ * replaces a random read of the full sample with the probability sample_max / (read_count + 1).
+ * Returns the cleared slot of the read, or nullptr if it is not sampled
+ */
+SampledRead * Readstats::sample_slot(uint64_t read_count, uint8_t readfile_idx, std::size_t read_num)
+{
+	if (sample_max == 0)
+		return nullptr;
+
+	std::size_t slot = sample.size();
+	if (slot < sample_max)
+		sample.emplace_back();
+	else
+	{
+		auto pos = std::uniform_int_distribution<uint64_t>(0, read_count)(sample_rng);
+		if (pos >= sample_max)
+			return nullptr;
+		slot = static_cast<std::size_t>(pos);
+		sample[slot] = SampledRead();
+	}
+	sample[slot].readfile_idx = readfile_idx;
+	sample[slot].read_num = read_num;
+	return &sample[slot];
+} // ~Readstats::sample_slot
+
 // determine the suffix (fasta, fastq, ...) of aligned strings
-// use the same suffix as the original reads file without 'gz' if gzipped.
+// use the same suffix as the original reads file without 'gz' | 'zst' if compressed.
 void Readstats::calcSuffix(Runopts &opts)
 {
 	size_t pos = opts.readfiles[0].rfind('.'); // find last '.' position
@@ -241,7 +366,11 @@ void Readstats::calcSuffix(Runopts &opts)
 	std::string sfx = opts.readfiles[0].substr(pos + 1);
 	std::string sfx_lower = to_lower(sfx);
 
-	if (opts.is_gz && "gz" == sfx_lower)
+	if (opts.readfiles_zip[0] == Runopts::ZIP_BAM)
+	{
+		sfx = "fastq"; // the reads are output as FASTQ (or FASTA if no qualities)
+	}
+	else if (opts.readfiles_zip[0] != Runopts::ZIP_NONE && ("gz" == sfx_lower || "zst" == sfx_lower))
 	{
 		pos2 = opts.readfiles[0].rfind('.', pos - 1);
 		sfx = opts.readfiles[0].substr(pos2 + 1, pos - pos2 - 1);
@@ -282,6 +411,9 @@ std::string Readstats::toBstring()
 	std::copy_n(static_cast<char*>(static_cast<void*>(&is_stats_calc)), sizeof(is_stats_calc), std::back_inserter(buf));
 	// is_total_reads_mapped_cov
 	std::copy_n(static_cast<char*>(static_cast<void*>(&is_total_reads_mapped_cov)), sizeof(is_total_reads_mapped_cov), std::back_inserter(buf));
+	// reads_over_budget (atomic int)
+	val = reads_over_budget.load();
+	std::copy_n(static_cast<char*>(static_cast<void*>(&val)), sizeof(val), std::back_inserter(buf));
 
 	return buf;
 } // ~Readstats::toBstring
@@ -298,6 +430,7 @@ std::string Readstats::toString()
 		<< " all_reads_len= " << all_reads_len
 		<< " total_reads_mapped= " << total_reads_aligned
 		<< " total_reads_mapped_cov= " << total_reads_mapped_cov
+		<< " reads_over_budget= " << reads_over_budget
 		<< " reads_matched_per_db= " << "TODO"
 		<< " is_total_reads_mapped_cov= " << is_total_reads_mapped_cov
 		<< " is_stats_calc= " << is_stats_calc << std::endl;
@@ -376,18 +509,63 @@ bool Readstats::restoreFromDb(KeyValueDatabase & kvdb)
 		// stats_calc_done
 		std::memcpy(static_cast<void*>(&is_total_reads_mapped_cov), bstr.data() + offset, sizeof(is_total_reads_mapped_cov));
 		offset += sizeof(is_total_reads_mapped_cov);
+
+		// reads_over_budget (absent in the stats stored before the work budget options were added)
+		if (offset + sizeof(val) <= bstr.size())
+		{
+			std::memcpy(static_cast<void*>(&val), bstr.data() + offset, sizeof(val));
+			reads_over_budget = val;
+			offset += sizeof(val);
+		}
 	} // ~if data found in DB
 
 	return ret;
 } // ~Readstats::restoreFromDb
 
-/* push entry to Readstats::otu_map*/
+/* push entry to Readstats::otu_map. Thread safe */
 void Readstats::pushOtuMap(std::string & ref_seq_str, std::string & read_seq_str)
 {
-	//std::lock_guard<std::mutex> omlg(otu_map_lock);
-	otu_map[ref_seq_str].push_back(read_seq_str);
+	std::lock_guard<std::mutex> omlg(otu_map_lock);
+	auto & reads = otu_map[ref_seq_str];
+	if (reads.empty())
+		otu_map_bytes += 4 * sizeof(void*) + sizeof(std::string) + sizeof(reads) + ref_seq_str.capacity(); // map node
+	reads.push_back(read_seq_str);
+	otu_map_bytes += sizeof(std::string) + read_seq_str.capacity();
+	if (otu_map_max_bytes > 0 && otu_map_bytes > otu_map_max_bytes)
+		spillOtuMap();
 }
 
+/* 
+ * Write the OTU map as a sorted run: one line per reference 'ref<TAB>read<TAB>read...'
+ * i.e. the format of the OTU map output file, so the runs can be merged line by line.
+ */
+void Readstats::spillOtuMap()
+{
+	if (otu_map.empty()) return;
+
+	std::filesystem::path spill_file = otu_spill_pfx;
+	spill_file += std::to_string(otu_spill_files.size()) + ".txt";
+	std::ofstream spill(spill_file, std::ios_base::out | std::ios_base::binary);
+	if (!spill.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open OTU map spill file " << spill_file;
+		ERR(ss.str());
+		exit(EXIT_FAILURE);
+	}
+	for (auto const & entry : otu_map)
+	{
+		spill << entry.first;
+		for (auto const & read_id : entry.second)
+			spill << "\t" << read_id;
+		spill << "\n";
+	}
+	spill.close();
+	otu_spill_files.push_back(spill_file);
+	otu_map.clear();
+	otu_map_bytes = 0;
+} // ~Readstats::spillOtuMap
+
 void Readstats::printOtuMap(std::string otumapfile)
 {
 	std::stringstream ss;
@@ -397,21 +575,79 @@ void Readstats::printOtuMap(std::string otumapfile)
 	ss << STAMP << "Printing OTU Map.." << std::endl;
 	std::cout << ss.str(); ss.str("");
 
-	for (std::map<std::string, std::vector<std::string>>::iterator it = otu_map.begin(); it != otu_map.end(); ++it)
+	if (otu_spill_files.empty())
+	{
+		for (std::map<std::string, std::vector<std::string>>::iterator it = otu_map.begin(); it != otu_map.end(); ++it)
+		{
+			omstrm << it->first << "\t";
+			int i = 0;
+			for (std::vector<std::string>::iterator itv = it->second.begin(); itv != it->second.end(); ++itv)
+			{
+				if (i < it->second.size() - 1)
+					omstrm << *itv << "\t";
+				else
+					omstrm << *itv; // last element
+				++i;
+			}
+			omstrm << std::endl;
+		}
+		total_otu = otu_map.size();
+	}
+	else
 	{
-		omstrm << it->first << "\t";
-		int i = 0;
-		for (std::vector<std::string>::iterator itv = it->second.begin(); itv != it->second.end(); ++itv)
+		// merge the sorted runs. Reads of a reference are output in the run order i.e. in the order they were pushed
+		spillOtuMap();
+		std::vector<std::ifstream> runs;
+		std::vector<std::string> lines(otu_spill_files.size());
+		for (std::size_t i = 0; i < otu_spill_files.size(); ++i)
 		{
-			if (i < it->second.size() - 1)
-				omstrm << *itv << "\t";
-			else
-				omstrm << *itv; // last element
-			++i;
+			runs.emplace_back(otu_spill_files[i], std::ios_base::in | std::ios_base::binary);
+			if (!std::getline(runs[i], lines[i])) lines[i].clear();
 		}
-		omstrm << std::endl;
+
+		ss << STAMP << "Merging " << runs.size() << " OTU map runs.." << std::endl;
+		std::cout << ss.str(); ss.str("");
+
+		for (;;)
+		{
+			std::string ref; // smallest reference among the current lines
+			bool is_found = false;
+			for (auto const & line : lines)
+			{
+				if (line.empty()) continue;
+				auto key = line.substr(0, line.find('\t'));
+				if (!is_found || key < ref)
+				{
+					ref = key;
+					is_found = true;
+				}
+			}
+			if (!is_found) break;
+
+			omstrm << ref;
+			for (std::size_t i = 0; i < lines.size(); ++i)
+			{
+				if (lines[i].empty() || lines[i].compare(0, lines[i].find('\t'), ref) != 0) continue;
+				omstrm << lines[i].substr(ref.size());
+				if (!std::getline(runs[i], lines[i])) lines[i].clear();
+			}
+			omstrm << std::endl;
+			++total_otu;
+		}
+
+		for (std::size_t i = 0; i < runs.size(); ++i)
+		{
+			runs[i].close();
+			std::filesystem::remove(otu_spill_files[i]);
+		}
+		otu_spill_files.clear();
 	}
 	if (omstrm.is_open()) omstrm.close();
+} // ~Readstats::printOtuMap
+
+std::size_t Readstats::otu_count()
+{
+	return otu_spill_files.empty() && total_otu == 0 ? otu_map.size() : total_otu;
 }
 
 void Readstats::store_to_db(KeyValueDatabase & kvdb)
@@ -0,0 +1,145 @@
+/**
+ * FILE: refclusters.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+#include "refclusters.hpp"
+#include "common.hpp"
+#include "aio.hpp"
+
+uint32_t RefClusters::add(const unsigned char *seq, uint32_t len)
+{
+	uint32_t ref = static_cast<uint32_t>(centroid_of.size());
+
+	// sampled k-mers. 32 bits hold CLUSTER_K nt i.e. the shift drops the nt leaving the k-mer
+	sketch.clear();
+	uint32_t kmer = 0;
+	for (uint32_t j = 0; j < len; ++j)
+	{
+		kmer = (kmer << 2) | (seq[j] & 3);
+		if (j + 1 >= CLUSTER_K && ((uint64_t(kmer) * 0x9E3779B97F4A7C15ULL) >> (64 - CLUSTER_SAMPLE_BITS)) == 0)
+			sketch.push_back(kmer);
+	}
+	std::sort(sketch.begin(), sketch.end());
+	sketch.erase(std::unique(sketch.begin(), sketch.end()), sketch.end());
+
+	// sampled k-mers shared with every centroid
+	uint32_t counted = 0; // sampled k-mers telling the centroids apart
+	for (auto val : sketch)
+	{
+		auto it = sketch_tbl.find(val);
+		if (it == sketch_tbl.end())
+		{
+			++counted;
+			continue;
+		}
+		if (it->second.size() >= CLUSTER_MAX_CENTROIDS) continue;
+		++counted;
+		for (auto centroid : it->second)
+			if (shared[centroid]++ == 0)
+				touched.push_back(centroid);
+	}
+
+	uint32_t best = ref;
+	uint32_t best_shared = 0;
+	for (auto centroid : touched)
+	{
+		auto len_min = std::min(len, lens[centroid]);
+		auto len_max = std::max(len, lens[centroid]);
+		if (len_min >= min_id * len_max && (shared[centroid] > best_shared || (shared[centroid] == best_shared && centroid < best)))
+		{
+			best = centroid;
+			best_shared = shared[centroid];
+		}
+		shared[centroid] = 0;
+	}
+	touched.clear();
+
+	if (best == ref || counted == 0 || best_shared < counted * std::pow(min_id, CLUSTER_K))
+	{
+		// new centroid
+		best = ref;
+		++centroids;
+		for (auto val : sketch)
+		{
+			auto &centroid_ids = sketch_tbl[val];
+			if (centroid_ids.size() < CLUSTER_MAX_CENTROIDS)
+				centroid_ids.push_back(ref);
+		}
+	}
+
+	centroid_of.push_back(best);
+	lens.push_back(len);
+	shared.push_back(0);
+	return best;
+} // ~RefClusters::add
+
+bool RefClusters::store(const std::string &file) const
+{
+	std::ofstream ofs(file, std::ios_base::out | std::ios_base::binary);
+	if (!ofs.is_open())
+		return false;
+
+	uint32_t numseq = static_cast<uint32_t>(centroid_of.size());
+	ofs.write(reinterpret_cast<const char*>(&numseq), sizeof(numseq));
+	ofs.write(reinterpret_cast<const char*>(centroid_of.data()), sizeof(uint32_t) * numseq);
+	return ofs.good();
+} // ~RefClusters::store
+
+bool RefClusters::load(const std::string &file, uint32_t numseq)
+{
+	clear();
+	AioIfstream ifs(file, std::ios_base::in | std::ios_base::binary);
+	if (!ifs.is_open())
+		return false;
+
+	uint32_t num = 0;
+	ifs.read(reinterpret_cast<char*>(&num), sizeof(num));
+	centroid_of.resize(num);
+	ifs.read(reinterpret_cast<char*>(centroid_of.data()), sizeof(uint32_t) * num);
+	if (!ifs.good() || num != numseq
+		|| std::any_of(centroid_of.begin(), centroid_of.end(), [num](uint32_t centroid) { return centroid >= num; }))
+	{
+		std::stringstream ss;
+		ss << STAMP << "Reference clusters file " << file << " is not valid for this index. Aligning the centroids only.";
+		WARN(ss.str());
+		clear();
+		return false;
+	}
+
+	// members per centroid
+	member_offsets.assign(num + 1, 0);
+	for (uint32_t ref = 0; ref < num; ++ref)
+	{
+		if (centroid_of[ref] == ref) ++centroids;
+		else ++member_offsets[centroid_of[ref] + 1];
+	}
+	for (uint32_t ref = 0; ref < num; ++ref)
+		member_offsets[ref + 1] += member_offsets[ref];
+	member_ids.resize(member_offsets[num]);
+	auto next = member_offsets;
+	for (uint32_t ref = 0; ref < num; ++ref)
+		if (centroid_of[ref] != ref)
+			member_ids[next[centroid_of[ref]]++] = ref;
+	return true;
+} // ~RefClusters::load
+
+void RefClusters::clear()
+{
+	centroids = 0;
+	centroid_of.clear();
+	sketch_tbl.clear();
+	lens.clear();
+	shared.clear();
+	member_offsets.clear();
+	member_ids.clear();
+} // ~RefClusters::clear
+
+// ~refclusters.cpp
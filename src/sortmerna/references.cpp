@@ -10,50 +10,87 @@
 #include <ios>
 #include <cstdint>
 #include <locale>
+#include <cstring> // strerror
+#include <cerrno>
 
 #include "references.hpp"
 #include "refstats.hpp"
 #include "options.hpp"
 #include "common.hpp"
+#include "aio.hpp"
 
 
+namespace {
+	const char REFS_MAGIC[8] = { 'S', 'M', 'R', 'R', 'E', 'F', 'S', '1' }; // packed references file signature and version
+}
+
 /**
  * load to memory the Reference records from a given index part
- * Read the reference file, extract the part's references into an array (vector) of reference objects
+ * Use the packed references file if available, otherwise parse the reference file and write the packed file
  */
 void References::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refstats & refstats)
 {
-	std::stringstream ss;
 	num = idx_num;
 	part = idx_part;
 	uint32_t numseq_part = refstats.index_parts_stats_vec[idx_num][idx_part].numseq_part;
+	std::string packfile = opts.indexfiles[idx_num].second + ".refs_" + std::to_string(idx_part) + ".dat";
 
-	std::ifstream ifs(opts.indexfiles[idx_num].first, std::ios_base::in | std::ios_base::binary); // open reference file
+	if (load_packed(packfile, numseq_part))
+		return;
+
+	load_text(opts.indexfiles[idx_num].first, refstats.index_parts_stats_vec[idx_num][idx_part].start_part, numseq_part);
+	store(packfile); // next time load packed
+} // ~References::load
+
+/**
+ * Read the reference file, extract the part's references into the sequence and header pools
+ *
+ * @param reffile      reference file
+ * @param start_part   offset of the first reference of the part in the file
+ * @param numseq_part  number of references in the part
+ */
+void References::load_text(const std::string &reffile, uint64_t start_part, uint32_t numseq_part)
+{
+	std::stringstream ss;
+	AioIfstream ifs(reffile, std::ios_base::in | std::ios_base::binary); // open reference file
 
 	if (!ifs.is_open())
 	{
-		ss << STAMP << "Could not open file " << opts.indexfiles[idx_num].first;
+		ss << STAMP << "Could not open file " << reffile;
 		ERR(ss.str());
 		std::cerr << ss.str();
 		exit(EXIT_FAILURE);
 	}
 
 	// set the file pointer to the first sequence added to the index for this index file section
-	ifs.seekg(refstats.index_parts_stats_vec[idx_num][idx_part].start_part);
+	ifs.seekg(start_part);
 	if (ifs.fail())
 	{
-		ss << STAMP << "Could not locate the reference file " << opts.indexfiles[idx_num].first << " used to construct the index";
+		ss << STAMP << "Could not locate the reference file " << reffile << " used to construct the index";
 		ERR(ss.str());
 		exit(EXIT_FAILURE);
 	}
 
+	clear();
+	seq_offsets.push_back(0);
+	hdr_offsets.push_back(0);
+	std::string seq_pool; // copied to the arena when complete
+	std::string hdr_pool;
+
 	// load references sequences, skipping the empty lines & spaces
 	uint64_t num_seq_read = 0;
 	std::string line;
-	References::BaseRecord rec;
+	bool isEmpty = true; // no current record
 	bool isFastq = true;
 	bool lastRec = false;
 
+	// close the current record
+	auto push_rec = [&]() {
+		seq_offsets.push_back(seq_pool.size());
+		hdr_offsets.push_back(hdr_pool.size());
+		num_seq_read++;
+	};
+
 	for (int count = 0; num_seq_read != numseq_part; )
 	{
 		if (!lastRec) std::getline(ifs, line);
@@ -66,40 +103,27 @@ void References::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refst
 
 		if (lastRec)
 		{
-			if (!rec.isEmpty)
-			{
-				rec.id = rec.getId();
-				rec.nid = num_seq_read;
-				buffer.push_back(rec);
-				num_seq_read++;
-			}
+			if (!isEmpty)
+				push_rec();
 			break;
 		}
 
 		// remove whitespace (removes '\r' too)
 		line.erase(std::find_if(line.rbegin(), line.rend(), [l = std::locale{}](auto ch) { return !std::isspace(ch, l); }).base(), line.end());
-		//line.erase(std::remove_if(begin(line), end(line), [l = std::locale{}](auto ch) { return std::isspace(ch, l); }), end(line));
-		//if (line[line.size() - 1] == '\r') line.erase(line.size() - 1); // remove trailing '\r'
 		// fastq: 0(header), 1(seq), 2(+), 3(quality)
 		// fasta: 0(header), 1(seq)
 		if (line[0] == FASTA_HEADER_START || line[0] == FASTQ_HEADER_START)
 		{
-			if (!rec.isEmpty)
+			if (!isEmpty)
 			{
-				rec.id = rec.getId();
-				rec.nid = num_seq_read;
-				buffer.push_back(rec); // push record created before this current header
-				rec.isEmpty = true;
-				num_seq_read++;
+				push_rec(); // push record created before this current header
 				count = 0;
 			}
 
 			// start new record
-			rec.clear();
 			isFastq = (line[0] == FASTQ_HEADER_START);
-			rec.format = isFastq ? Format::FASTQ : Format::FASTA;
-			rec.header = line;
-			rec.isEmpty = false;
+			hdr_pool += line;
+			isEmpty = false;
 		} // ~header or last record
 		else
 		{
@@ -114,18 +138,86 @@ void References::load(uint32_t idx_num, uint32_t idx_part, Runopts & opts, Refst
 
 			if (isFastq && line[0] == '+') continue;
 
-			if (isFastq && count == 3)
-			{
-				rec.quality = line;
-				continue;
-			}
+			if (isFastq && count == 3) continue; // quality is not used for the references
 
 			convert_fix(line);
-			rec.sequence += line;
+			seq_pool += line;
 		} // ~not header
 		if (ifs.eof()) lastRec = true; // push and break
 	} // ~for
-} // ~References::load
+
+	seqs = arena.alloc_array<char>(seq_pool.size());
+	headers = arena.alloc_array<char>(hdr_pool.size());
+	std::copy(seq_pool.begin(), seq_pool.end(), seqs);
+	std::copy(hdr_pool.begin(), hdr_pool.end(), headers);
+} // ~References::load_text
+
+bool References::load_packed(const std::string &packfile, uint32_t numseq_part)
+{
+	AioIfstream ifs(packfile, std::ios_base::in | std::ios_base::binary);
+	if (!ifs.is_open())
+		return false;
+
+	char magic[sizeof(REFS_MAGIC)] = { 0 };
+	uint32_t numseq = 0;
+	uint64_t seq_bytes = 0;
+	uint64_t hdr_bytes = 0;
+	ifs.read(magic, sizeof(magic));
+	ifs.read(reinterpret_cast<char*>(&numseq), sizeof(numseq));
+	ifs.read(reinterpret_cast<char*>(&seq_bytes), sizeof(seq_bytes));
+	ifs.read(reinterpret_cast<char*>(&hdr_bytes), sizeof(hdr_bytes));
+	if (!ifs.good() || !std::equal(magic, magic + sizeof(magic), REFS_MAGIC) || numseq != numseq_part)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Packed references file " << packfile << " is not valid for this index. Using the reference file.";
+		WARN(ss.str());
+		return false;
+	}
+
+	clear();
+	seq_offsets.resize(numseq + 1);
+	hdr_offsets.resize(numseq + 1);
+	seqs = arena.alloc_array<char>(seq_bytes);
+	headers = arena.alloc_array<char>(hdr_bytes);
+	ifs.read(reinterpret_cast<char*>(seq_offsets.data()), sizeof(uint64_t) * seq_offsets.size());
+	ifs.read(reinterpret_cast<char*>(hdr_offsets.data()), sizeof(uint64_t) * hdr_offsets.size());
+	ifs.read(seqs, seq_bytes);
+	ifs.read(headers, hdr_bytes);
+
+	if (!ifs.good() || seq_offsets.back() != seq_bytes || hdr_offsets.back() != hdr_bytes)
+	{
+		std::stringstream ss;
+		ss << STAMP << "Packed references file " << packfile << " is truncated. Using the reference file.";
+		WARN(ss.str());
+		clear();
+		return false;
+	}
+	return true;
+} // ~References::load_packed
+
+void References::store(const std::string &packfile)
+{
+	std::ofstream ofs(packfile, std::ios_base::out | std::ios_base::binary);
+	if (!ofs.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open file [" << packfile << "] for writing: " << strerror(errno);
+		WARN(ss.str());
+		return;
+	}
+
+	uint32_t numseq = static_cast<uint32_t>(size());
+	uint64_t seq_bytes = seq_offsets.empty() ? 0 : seq_offsets.back();
+	uint64_t hdr_bytes = hdr_offsets.empty() ? 0 : hdr_offsets.back();
+	ofs.write(REFS_MAGIC, sizeof(REFS_MAGIC));
+	ofs.write(reinterpret_cast<const char*>(&numseq), sizeof(numseq));
+	ofs.write(reinterpret_cast<const char*>(&seq_bytes), sizeof(seq_bytes));
+	ofs.write(reinterpret_cast<const char*>(&hdr_bytes), sizeof(hdr_bytes));
+	ofs.write(reinterpret_cast<const char*>(seq_offsets.data()), sizeof(uint64_t) * seq_offsets.size());
+	ofs.write(reinterpret_cast<const char*>(hdr_offsets.data()), sizeof(uint64_t) * hdr_offsets.size());
+	ofs.write(seqs, seq_bytes);
+	ofs.write(headers, hdr_bytes);
+} // ~References::store
 
   // convert sequence to numerical form and fix ambiguous chars
 void References::convert_fix(std::string & seq)
@@ -142,7 +234,8 @@ std::string References::convertChar(int idx)
 	std::stringstream ss;
 	std::string chstr;
 	//const char nt_map[5] = { 'A', 'C', 'G', 'T', 'N' }; // TODO: move to common
-	for (std::string::iterator it = buffer[idx].sequence.begin(); it != buffer[idx].sequence.end(); ++it)
+	auto seq = sequence(idx);
+	for (auto it = seq.begin(); it != seq.end(); ++it)
 	{
 		if (*it < 5)
 			chstr += nt_map[(int)*it];
@@ -163,9 +256,9 @@ std::string References::convertChar(int idx)
 int References::findref(std::string id)
 {
 	int retpos = -1;
-	for (int i = 0; i < buffer.size(); ++i)
+	for (int i = 0; i < size(); ++i)
 	{
-		if (std::string::npos != buffer[i].header.find(id)) {
+		if (std::string::npos != header(i).find(id)) {
 			retpos = i;
 			break; 
 		}
@@ -176,5 +269,15 @@ int References::findref(std::string id)
 
 void References::clear()
 {
-	buffer.clear(); // TODO: is this enough?
+	seqs = nullptr;
+	seq_offsets.clear();
+	headers = nullptr;
+	hdr_offsets.clear();
+	arena.clear();
 } // ~References::clear
+
+void References::mem_size(std::size_t &seq_bytes, std::size_t &hdr_bytes) const
+{
+	seq_bytes = (seq_offsets.empty() ? 0 : seq_offsets.back()) + seq_offsets.capacity() * sizeof(uint64_t);
+	hdr_bytes = (hdr_offsets.empty() ? 0 : hdr_offsets.back()) + hdr_offsets.capacity() * sizeof(uint64_t);
+}
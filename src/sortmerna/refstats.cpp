@@ -8,6 +8,7 @@
 #include <sstream>
 #include <ios>
 #include <vector>
+#include <filesystem>
 
 #include "sls_alignment_evaluer.hpp" // ../alp/
 
@@ -23,6 +24,8 @@ Refstats::Refstats(Runopts & opts, Readstats & readstats)
 	full_read(opts.indexfiles.size(), readstats.all_reads_len),
 	lnwin(opts.indexfiles.size(), 0),
 	partialwin(opts.indexfiles.size(), 0),
+	win_span(opts.indexfiles.size(), 0),
+	seed_offsets(opts.indexfiles.size()),
 	minimal_score(opts.indexfiles.size(), 0),
 	gumbel(opts.indexfiles.size(), std::pair<double, double>(-1.0, -1.0)),
 	numbvs(opts.indexfiles.size(), 0),
@@ -113,14 +116,6 @@ void Refstats::load(Runopts & opts, Readstats & readstats)
 		// number of bitvectors at depth > 0 in [w_1] reverse or [w_2] forward
 		numbvs[index_num] = 4 * (partialwin[index_num] - 3);
 
-		// set the window shift for different seed lengths (if not set by user, or one of the lengths is <= 0)
-		if ((opts.skiplengths[index_num][0] == 0) || (opts.skiplengths[index_num][1] == 0) || (opts.skiplengths[index_num][2] == 0))
-		{
-			opts.skiplengths[index_num][0] = lnwin[index_num];
-			opts.skiplengths[index_num][1] = partialwin[index_num];
-			opts.skiplengths[index_num][2] = 3;
-		}
-
 		// get number of index parts i.e. how many parts the index has
 		stats.read(reinterpret_cast<char*>(&num_index_parts[index_num]), sizeof(uint16_t));
 
@@ -136,6 +131,76 @@ void Refstats::load(Runopts & opts, Readstats & readstats)
 
 		index_parts_stats_vec.push_back(hold);
 
+		// skip the reference sequence ids and lengths (see Output::writeSamHeader)
+		uint32_t num_sq = 0;
+		stats.read(reinterpret_cast<char*>(&num_sq), sizeof(uint32_t));
+		for (uint32_t j = 0; j < num_sq && stats.good(); j++)
+		{
+			uint32_t len_id = 0;
+			stats.read(reinterpret_cast<char*>(&len_id), sizeof(uint32_t));
+			stats.seekg(len_id + sizeof(uint32_t), std::ios_base::cur);
+		}
+
+		// spaced seed mask (OPT_SEED_MASK). Absent in the indexes built before i.e. contiguous seed
+		uint32_t mask_len = 0;
+		std::string mask;
+		if (stats.read(reinterpret_cast<char*>(&mask_len), sizeof(uint32_t)) && mask_len > 0)
+		{
+			mask.resize(mask_len);
+			stats.read(&mask[0], mask_len);
+		}
+		win_span[index_num] = lnwin[index_num];
+		if (mask.size() > 0)
+		{
+			for (uint32_t j = 0; j < mask.size(); j++)
+				if (mask[j] == '1') seed_offsets[index_num].push_back(j);
+			win_span[index_num] = static_cast<uint32_t>(mask.size());
+			if (!stats || seed_offsets[index_num].size() != lnwin[index_num])
+			{
+				ss.str("");
+				ss << STAMP << "Invalid spaced seed mask in the index file [" << opts.indexfiles[index_num].second << ".stats]";
+				ERR(ss.str());
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (opts.seed_mask != mask)
+		{
+			ss.str("");
+			ss << STAMP << "The index [" << opts.indexfiles[index_num].second << "] was built with the seed mask '" << mask
+				<< "'. Option '" << OPT_SEED_MASK << "' '" << opts.seed_mask << "' is ignored";
+			WARN(ss.str());
+		}
+
+		// DUST threshold of the index (OPT_DUST). Absent in the indexes built before i.e. off
+		double dust = 0;
+		if (!stats.read(reinterpret_cast<char*>(&dust), sizeof(double)))
+			dust = 0;
+		if (opts.dust != dust)
+		{
+			ss.str("");
+			ss << STAMP << "The index [" << opts.indexfiles[index_num].second << "] was built with '" << OPT_DUST << "' " << dust
+				<< ". Option '" << OPT_DUST << "' " << opts.dust << " masks the read windows only. Rebuild the index to mask the references alike";
+			WARN(ss.str());
+		}
+
+		// reference clusters (OPT_CLUSTER_ID). The parts of an index are all clustered or none
+		if (opts.cluster_id > 0 && !std::filesystem::exists(opts.indexfiles[index_num].second + ".clust_0.dat"))
+		{
+			ss.str("");
+			ss << STAMP << "The index [" << opts.indexfiles[index_num].second << "] was built without reference clusters. Option '"
+				<< OPT_CLUSTER_ID << "' " << opts.cluster_id << " is ignored";
+			WARN(ss.str());
+		}
+
+		// set the window shift for different seed lengths (if not set by user, or one of the lengths is <= 0)
+		if ((opts.skiplengths[index_num][0] == 0) || (opts.skiplengths[index_num][1] == 0) || (opts.skiplengths[index_num][2] == 0))
+		{
+			opts.skiplengths[index_num][0] = win_span[index_num];
+			opts.skiplengths[index_num][1] = partialwin[index_num];
+			// the hits of a spaced seed at the neighbouring positions are less correlated: a sparser last pass
+			opts.skiplengths[index_num][2] = seed_offsets[index_num].empty() ? 3 : lnwin[index_num] / 3;
+		}
+
 		// Gumbel parameters
 		long **substitutionScoreMatrix = scoring_matrix;
 		long gapOpen1 = opts.gap_open;
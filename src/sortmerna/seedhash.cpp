@@ -0,0 +1,128 @@
+/**
+ * FILE: seedhash.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include "indexdb.hpp" // kmer, NodeElement, ENTRYSIZE
+#include "seedhash.hpp"
+
+/*
+ * collect the (L+1)-mers of a mini-burst trie in the order the trie search visits them:
+ * the node elements A,C,G,T depth first, the bucket entries in the stored order.
+ *
+ * @param path   nucleotides from the root to the node, 2 bits/nt, first nt highest
+ * @param seeds  OUT (first 'partialwin' nt of the trie part of the (L+1)-mer, id)
+ */
+void SeedHash::collect(const NodeElement *node, uint32_t depth, uint64_t path, std::vector<std::pair<uint64_t, uint32_t>> &seeds) const
+{
+	for (uint32_t nt = 0; nt < 4; ++nt, ++node)
+	{
+		uint64_t node_path = (path << 2) | nt;
+		if (node->flag == 1)
+			collect(node->nodetype.trie, depth + 1, node_path, seeds);
+		else if (node->flag == 2)
+		{
+			// an entry holds the 'partialwin - depth' nt below this node element, first nt lowest
+			auto *entry = static_cast<const unsigned char*>(node->nodetype.bucket);
+			auto *end = entry + node->size;
+			for (; entry != end; entry += ENTRYSIZE)
+			{
+				uint32_t entry_str = *reinterpret_cast<const uint32_t*>(entry);
+				uint64_t seed = node_path;
+				for (uint32_t j = depth + 1; j < partialwin; ++j, entry_str >>= 2)
+					seed = (seed << 2) | (entry_str & 3);
+				seeds.emplace_back(seed, *(reinterpret_cast<const uint32_t*>(entry) + 1));
+			}
+		}
+	}
+} // ~SeedHash::collect
+
+void SeedHash::resize(std::size_t num_slots)
+{
+	std::vector<uint64_t> old(num_slots, EMPTY);
+	old.swap(slots);
+	mask = num_slots - 1;
+	shift = 64;
+	for (auto n = num_slots; n > 1; n >>= 1) --shift;
+	for (auto entry : old)
+	{
+		if (entry == EMPTY) continue;
+		auto pos = slot(entry >> id_bits);
+		while (slots[pos] != EMPTY) pos = (pos + 1) & mask;
+		slots[pos] = entry;
+	}
+} // ~SeedHash::resize
+
+bool SeedHash::insert(uint64_t key, uint32_t id)
+{
+	if (4 * (num_seeds + 1) > 3 * slots.size()) // load <= 0.75
+		resize(2 * slots.size());
+	for (auto pos = slot(key);; pos = (pos + 1) & mask)
+	{
+		if (slots[pos] == EMPTY)
+		{
+			slots[pos] = (key << id_bits) | id;
+			++num_seeds;
+			return true;
+		}
+		if ((slots[pos] >> id_bits) == key)
+			return false;
+	}
+} // ~SeedHash::insert
+
+void SeedHash::build(const std::vector<kmer> &lookup_tbl, uint32_t number_elements, uint32_t partialwin, uint32_t minoccur)
+{
+	clear();
+	this->partialwin = partialwin;
+	half_bits = 2 * partialwin;
+	if (number_elements > SEEDHASH_MAX_KMERS || 2 * half_bits >= 64)
+		return;
+	id_bits = 64 - 2 * half_bits;
+	id_mask = (uint64_t(1) << id_bits) - 1;
+	if (number_elements >= id_mask) // the largest id must not make an EMPTY entry
+		return;
+
+	// the forward seeds are inserted first: the reverse trie is only searched without an exact forward match.
+	// Most of the reverse seeds are the forward ones
+	std::size_t num_slots = 2;
+	while (3 * num_slots < 4 * std::size_t(number_elements))
+		num_slots <<= 1;
+	resize(num_slots);
+
+	// 'insert' keeps the first seed in the trie order
+	std::vector<std::pair<uint64_t, uint32_t>> trie_seeds;
+	for (uint32_t key = 0; key < lookup_tbl.size(); ++key)
+	{
+		// trie_F[w_1]: the nt following w_1 i.e. the seed is w_1 + trie part
+		if (lookup_tbl[key].count <= minoccur || lookup_tbl[key].trie_F == nullptr) continue;
+		trie_seeds.clear();
+		collect(lookup_tbl[key].trie_F, 0, 0, trie_seeds);
+		for (auto const &seed : trie_seeds)
+			insert((uint64_t(key) << half_bits) | seed.first, seed.second);
+	}
+	for (uint32_t key = 0; key < lookup_tbl.size(); ++key)
+	{
+		// trie_R[w_2]: the nt preceding w_2 in the reverse order i.e. the seed is reversed(trie part) + w_2
+		if (lookup_tbl[key].count <= minoccur || lookup_tbl[key].trie_R == nullptr) continue;
+		trie_seeds.clear();
+		collect(lookup_tbl[key].trie_R, 0, 0, trie_seeds);
+		for (auto const &seed : trie_seeds)
+		{
+			uint64_t w_1 = 0;
+			for (uint32_t j = 0; j < partialwin; ++j)
+				w_1 = (w_1 << 2) | ((seed.first >> (2 * j)) & 3);
+			insert((w_1 << half_bits) | key, seed.second);
+		}
+	}
+} // ~SeedHash::build
+
+void SeedHash::clear()
+{
+	std::vector<uint64_t>().swap(slots);
+	mask = 0;
+	shift = 64;
+	num_seeds = 0;
+} // ~SeedHash::clear
+
+// ~seedhash.cpp
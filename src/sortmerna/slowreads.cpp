@@ -0,0 +1,108 @@
+/**
+ * FILE: slowreads.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+
+#include "common.hpp"
+#include "options.hpp"
+#include "read.hpp"
+#include "slowreads.hpp"
+
+thread_local ReadDiag *read_diag = nullptr;
+
+namespace {
+	bool is_slow_log = false;
+	double threshold_ms = 0;
+	std::filesystem::path slow_file;
+	std::ofstream slow_log;
+	std::mutex slow_lock;
+	std::size_t num_slow = 0;
+	double worst_ms = 0;
+	std::string worst_id;
+}
+
+void SlowReads::open(Runopts &opts)
+{
+	if (opts.slow_read_ms <= 0)
+		return;
+
+	threshold_ms = opts.slow_read_ms;
+	slow_file = opts.outdir / "slow_reads.tsv";
+	slow_log.open(slow_file, std::ios_base::out | std::ios_base::binary);
+	if (!slow_log.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open slow reads log: " << slow_file << ". Continuing without the log.";
+		WARN(ss.str());
+		return;
+	}
+	slow_log << "#read_id\theader\tlength\tindex\tpart\tms\tpasses\twindows\tmasked\treadhit\tid_win_hits\tcandidates\tsw_calls\taligned\n";
+	is_slow_log = true;
+	std::cout << STAMP << "Logging reads slower than " << threshold_ms << " ms into " << std::filesystem::absolute(slow_file) << std::endl;
+}
+
+void SlowReads::close()
+{
+	if (!is_slow_log)
+		return;
+	slow_log.close();
+	is_slow_log = false;
+	std::stringstream ss;
+	ss << STAMP << "Slow reads (> " << threshold_ms << " ms): " << num_slow;
+	if (num_slow > 0)
+		ss << " Slowest: " << worst_id << " " << std::setprecision(2) << std::fixed << worst_ms << " ms";
+	ss << " Log: " << std::filesystem::absolute(slow_file) << std::endl;
+	std::cout << ss.str();
+}
+
+bool SlowReads::is_on() { return is_slow_log; }
+
+SlowReads::SlowReads()
+{
+	if (is_slow_log) read_diag = &diag;
+}
+
+SlowReads::~SlowReads()
+{
+	if (read_diag == &diag) read_diag = nullptr;
+}
+
+void SlowReads::start()
+{
+	if (!is_slow_log) return;
+	diag = ReadDiag();
+	t0 = std::chrono::steady_clock::now();
+}
+
+void SlowReads::finish(Read &read, uint16_t index_num, uint32_t part)
+{
+	if (!is_slow_log) return;
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	if (ms < threshold_ms) return;
+
+	std::stringstream ss;
+	ss << read.id << "\t" << read.header.substr(0, read.header.find(' ')) << "\t" << read.sequence.size()
+		<< "\t" << index_num << "\t" << part + 1
+		<< "\t" << std::setprecision(3) << std::fixed << ms
+		<< "\t" << diag.passes << "\t" << diag.windows << "\t" << diag.masked << "\t" << read.readhit << "\t" << diag.max_hits
+		<< "\t" << diag.candidates << "\t" << diag.sw_calls << "\t" << read.is_hit << "\n";
+
+	std::lock_guard<std::mutex> lg(slow_lock);
+	slow_log << ss.str();
+	++num_slow;
+	if (ms > worst_ms)
+	{
+		worst_ms = ms;
+		worst_id = read.id;
+	}
+} // ~SlowReads::finish
+
+// ~slowreads.cpp
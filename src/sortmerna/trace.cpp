@@ -0,0 +1,136 @@
+/**
+ * FILE: trace.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * @copyright 2016-20 Clarity Genomics BVBA
+ */
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#include "common.hpp"
+#include "trace.hpp"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	std::atomic<bool> is_tracing(false);
+	std::string trace_file;
+	std::chrono::steady_clock::time_point trace_start;
+	std::mutex events_lock;
+	std::vector<std::string> events; // serialized JSON events
+	std::atomic<int> next_tid(0);
+	thread_local int tid = -1; // small sequential thread ids read better in the viewers than hashed std::thread::id
+
+	int get_tid()
+	{
+		if (tid < 0) tid = next_tid++;
+		return tid;
+	}
+}
+
+void Trace::start(const std::string &file)
+{
+	trace_file = file;
+	trace_start = std::chrono::steady_clock::now();
+	is_tracing = true;
+	Trace::thread_name("main");
+	std::cout << STAMP << "Recording trace into: " << std::filesystem::absolute(trace_file) << std::endl;
+}
+
+bool Trace::is_on() { return is_tracing; }
+
+int64_t Trace::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+void Trace::complete(const std::string &name, const char *cat, int64_t ts, const std::string &args)
+{
+	if (!is_tracing) return;
+	std::stringstream ss;
+	ss << "{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\",\"ts\":" << ts
+		<< ",\"dur\":" << Trace::now() - ts << ",\"pid\":" << getpid() << ",\"tid\":" << get_tid();
+	if (!args.empty())
+		ss << ",\"args\":{" << args << "}";
+	ss << "}";
+	std::lock_guard<std::mutex> lg(events_lock);
+	events.push_back(ss.str());
+}
+
+void Trace::thread_name(const std::string &name)
+{
+	if (!is_tracing) return;
+	std::stringstream ss;
+	ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << getpid() << ",\"tid\":" << get_tid()
+		<< ",\"args\":{\"name\":\"" << name << "\"}}";
+	std::lock_guard<std::mutex> lg(events_lock);
+	events.push_back(ss.str());
+}
+
+void Trace::write()
+{
+	if (!is_tracing) return;
+	std::lock_guard<std::mutex> lg(events_lock);
+	std::ofstream ofs(trace_file, std::ios_base::out | std::ios_base::binary);
+	if (!ofs.is_open())
+	{
+		std::stringstream ss;
+		ss << STAMP << "Failed to open trace file: " << trace_file;
+		WARN(ss.str());
+		return;
+	}
+	ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (std::size_t i = 0; i < events.size(); ++i)
+	{
+		ofs << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+	}
+	ofs << "]}\n";
+	std::cout << STAMP << "Trace events written: " << events.size() << " into " << std::filesystem::absolute(trace_file) << std::endl;
+} // ~Trace::write
+
+TraceSpan::TraceSpan(const std::string &name, const char *cat, const std::string &args)
+	: name(name), cat(cat), args(args), ts(is_tracing ? Trace::now() : 0)
+{}
+
+TraceSpan::~TraceSpan()
+{
+	if (is_tracing) Trace::complete(name, cat, ts, args);
+}
+
+TraceBatch::TraceBatch(const char *name, const char *cat, const std::string &job)
+	: name(name), cat(cat), job(job), ts(is_tracing ? Trace::now() : 0)
+{}
+
+TraceBatch::~TraceBatch()
+{
+	if (count > 0) emit();
+}
+
+void TraceBatch::add(std::size_t num)
+{
+	if (!is_tracing) return;
+	count += num;
+	if (count >= TRACE_BATCH) emit();
+}
+
+void TraceBatch::emit()
+{
+	if (!is_tracing) return;
+	Trace::complete(name, cat, ts, "\"job\":\"" + job + "\",\"items\":" + std::to_string(count));
+	count = 0;
+	ts = Trace::now();
+}
+
+// ~trace.cpp
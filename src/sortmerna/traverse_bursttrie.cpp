@@ -93,8 +93,12 @@ uint32_t table[4][16][14] = {
 	{{10, 14, 14, 14, 14, 14, 14, 14, 14, 10, 14, 14, 14, 14},
 	{10, 10, 14, 10, 14, 10, 14, 10, 14, 10, 14, 14, 10, 14}} };
 
-/*! @fn traversetrie_align() */
-void traversetrie_align(
+/*! @fn traversetrie_align_n()
+	@brief traversetrie_align with the half seed length PARTIALWIN known at compile time, which folds
+	the Levenshtein table indexing and the bucket entry length. PARTIALWIN = 0 - runtime 'partialwin'
+*/
+template <uint32_t PARTIALWIN>
+void traversetrie_align_n(
 	NodeElement *trie_t,
 	uint32_t lev_t,
 	unsigned char depth,
@@ -108,6 +112,8 @@ void traversetrie_align(
 	Runopts & opts
 )
 {
+	if (PARTIALWIN > 0) partialwin = PARTIALWIN;
+
 	uint16_t lev_t_trie_pivot = lev_t;
 	unsigned char value = 0;
 
@@ -149,7 +155,7 @@ void traversetrie_align(
 				// (1) the node element holds a pointer to another trie node
 				if (value == 1)
 				{
-					traversetrie_align(trie_t->nodetype.trie,
+					traversetrie_align_n<PARTIALWIN>(trie_t->nodetype.trie,
 						lev_t,
 						++depth,
 						win_k1_ptr,
@@ -294,8 +300,47 @@ void traversetrie_align(
 	}//~for 4 node elements
 
 	return;
+}//~traversetrie_align_n()
+
+/*! @fn traversetrie_align() */
+void traversetrie_align(
+	NodeElement *trie_t,
+	uint32_t lev_t,
+	unsigned char depth,
+	UCHAR *win_k1_ptr,
+	UCHAR *win_k1_full,
+	bool &accept_zero_kmer,
+	std::vector<id_win> &id_hits,
+	uint32_t win_num,
+	uint32_t partialwin,
+	Runopts & opts
+)
+{
+	traversetrie_align_n<0>(trie_t, lev_t, depth, win_k1_ptr, win_k1_full, accept_zero_kmer, id_hits, win_num, partialwin, opts);
 }//~traversetrie_align()
 
+namespace {
+	template <uint32_t PARTIALWIN>
+	constexpr SeedKernels seed_kernels()
+	{
+		return { PARTIALWIN, init_win_f_n<4 * (PARTIALWIN - 3)>, init_win_r_n<4 * (PARTIALWIN - 3)>, traversetrie_align_n<PARTIALWIN> };
+	}
+
+	// seed length 12, 14, 16, 18 (default), 20
+	const SeedKernels kernels[] = { seed_kernels<6>(), seed_kernels<7>(), seed_kernels<8>(), seed_kernels<9>(), seed_kernels<10>() };
+	const SeedKernels generic_kernels = { 0, init_win_f, init_win_r, traversetrie_align };
+}
+
+const SeedKernels * select_seed_kernels(uint32_t partialwin)
+{
+	for (const auto & kern : kernels)
+	{
+		if (kern.partialwin == partialwin)
+			return &kern;
+	}
+	return &generic_kernels;
+}//~select_seed_kernels()
+
 
 #ifdef see_binary_output
 /*
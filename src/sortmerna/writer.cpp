@@ -9,6 +9,8 @@
 #include <iostream>
 
 #include "writer.hpp"
+#include "perfcounters.hpp"
+#include "trace.hpp"
 
 
 // write read alignment results to disk using e.g. RocksDB
@@ -21,6 +23,9 @@ void Writer::write()
 	}
 
 	auto t = std::chrono::high_resolution_clock::now();
+	PerfCounters perf(id, opts.is_perf); // no-op unless '--perf'
+	Trace::thread_name(id);
+	TraceBatch batch("kvdb_put", "kvdb", id); // no-op unless '--trace'
 	int numPopped = 0;
 	std::size_t num_aligned = 0; // num reads with 'read.hit = true' i.e. passing E-value threshold
 	for (;;) 
@@ -36,12 +41,14 @@ void Writer::write()
 		}
 		++numPopped;
 		//std::string matchResultsStr = read.matchesToJson();
+		PerfScope perf_kvdb(PerfStage::KVDB);
 		std::string readstr = read.toString();
 		if (!opts.is_dbg_put_kvdb && readstr.size() > 0)
 		{
 			if (read.is_hit) ++num_aligned;
 			kvdb.put(read.id, readstr);
 		}
+		batch.add();
 	}
 	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - t;
 
@@ -10,6 +10,7 @@
 
 // forward
 void kvdb_clear();
+void near_exact_vs_ssw(); // near_exact.cpp
 
 /**
  * Case 1
@@ -30,7 +31,7 @@ void reader_nextread(std::vector<std::string> &filev)
 
 		std::ifstream ifs(rfile, std::ios_base::in | std::ios_base::binary);
 		std::string seq;
-		Reader reader("0", true);
+		Reader reader("0", Runopts::ZIP_GZIP);
 		std::cout << "Reads file: " << rfile << std::endl;
 		size_t count = 0;
 		for (bool hasrec = true; hasrec;)
@@ -53,7 +54,7 @@ int main(int argc, char** argv)
 {
 	std::cout << STAMP << "Running with " << argc << " options" << std::endl;
 	//Runopts opts(argc, argv, false);
-	if (argc > 2)
+	if (argc > 1)
 	{
 		std::cout << "argv[0]: " << argv[0] << std::endl;
 		std::cout << "Case: " << argv[1] << std::endl;
@@ -74,6 +75,9 @@ int main(int argc, char** argv)
 				reader_nextread(filev);
 			}
 			break;
+		case 2:
+			near_exact_vs_ssw();
+			break;
 		default:
 			std::cout << "Unknown arg: " << scase << std::endl;
 		}
@@ -0,0 +1,83 @@
+/**
+ * FILE: near_exact.cpp
+ * Created: Oct 18, 2026 Sun
+ *
+ * The near exact fast path ('near_exact_align') against Smith-Waterman ('ssw_align'):
+ * the same alignment when the fast path is taken, with the default and a low gap penalty
+ */
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "alignment.hpp"
+#include "ssw.h"
+
+/*
+ * @param gap_open  SW gap open penalty. 1 - a gap pair costs less than a mismatch
+ * @return number of the reads taken by the fast path
+ */
+static uint32_t near_exact_case(int8_t match, int8_t mismatch, long gap_open, long gap_ext, uint32_t num_reads)
+{
+	std::vector<int8_t> matrix(25);
+	for (int i = 0; i < 5; ++i)
+		for (int j = 0; j < 5; ++j)
+			matrix[i * 5 + j] = (i == 4 || j == 4) ? -1 : (i == j ? match : mismatch);
+
+	std::mt19937 rng(1);
+	uint32_t num_taken = 0;
+	for (uint32_t n = 0; n < num_reads; ++n)
+	{
+		// a read of the reference with 0 or 1 substitutions. Low complexity every 4th: the gaps are cheap in the repeats
+		uint32_t reflen = 500 + rng() % 500;
+		std::string ref(reflen, 0);
+		for (auto & nt : ref)
+			nt = static_cast<char>(n % 4 == 0 ? rng() % 2 : rng() % 4);
+		uint32_t readlen = 50 + rng() % 250;
+		uint32_t diag = rng() % (reflen - readlen);
+		std::string read = ref.substr(diag, readlen);
+		if (rng() % 2)
+		{
+			auto pos = rng() % readlen;
+			read[pos] = static_cast<char>((read[pos] + 1 + rng() % 3) % 4);
+		}
+
+		// the SW region as in 'compute_lis_alignment'
+		uint32_t head = std::min<uint32_t>(diag, 20);
+		uint32_t tail = std::min<uint32_t>(reflen - diag - readlen, 20);
+		uint32_t ref_base = diag - head;
+
+		s_align *fast = near_exact_align(read.data(), ref.data() + diag, readlen, matrix.data(), gap_open, head);
+		if (fast == 0)
+			continue;
+		++num_taken;
+
+		s_profile *profile = ssw_init((int8_t*)read.data(), readlen, matrix.data(), 5, 2);
+		s_align *sw = ssw_align(profile, (int8_t*)ref.data() + ref_base, readlen + head + tail, gap_open, gap_ext, 2, 0, 0, 0);
+		assert(sw != 0);
+		assert(sw->score1 == fast->score1);
+		if (sw->cigarLen == 1) // equal scores: the gapped SW path is as good
+		{
+			assert(sw->ref_begin1 == fast->ref_begin1 && sw->ref_end1 == fast->ref_end1);
+			assert(sw->read_begin1 == fast->read_begin1 && sw->read_end1 == fast->read_end1);
+			assert(sw->cigar[0] == fast->cigar[0]);
+		}
+		init_destroy(&profile);
+		align_destroy(&sw);
+		align_destroy(&fast);
+	}
+	return num_taken;
+} // ~near_exact_case
+
+void near_exact_vs_ssw()
+{
+	auto num_default = near_exact_case(2, -3, 5, 2, 5000);
+	auto num_low_gap = near_exact_case(2, -3, 1, 1, 5000);
+	std::cout << "near exact reads taken: default scoring " << num_default << " gap_open 1 " << num_low_gap << std::endl;
+	assert(num_default > 0);
+} // ~near_exact_vs_ssw
+
+// ~near_exact.cpp